@@ -0,0 +1,108 @@
+#include <mempool.h>
+#include <mempool/simple.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Long-running churn: the working set grows to the peak, then objects are
+// randomly released and reallocated while the working set shrinks. After each
+// round empty slabs are reaped and the number of mapped slabs is sampled
+// (resident set size isn't reliable here since free may keep memory mapped).
+// The run is made twice: with allocation from the fullest slab first and with
+// the former policy which elects the slab a block has been released to last;
+// the latter is reproduced with pool_object_alloc_near hinted with the last
+// released object. With the fullest slab first, steady-state slab count
+// follows the working set instead of staying at the peak.
+
+#define PEAK_OBJECTS ( 1u << 20 )
+#define ROUNDS 64
+#define REPORT_EVERY 8
+#define CHURN_PER_ROUND ( PEAK_OBJECTS * 4 )
+
+static size_t _run( const char *name, int last_released ) {
+	static slab_class_t sclass = {
+		.blk_sz = 120,
+		.align = 8,
+		.ctag = NULL,
+		.ctor = NULL,
+		.dtor = NULL,
+		.reinit = NULL
+	};
+
+	cache_t *c = pool_simple_create( 0, &sclass, 0 );
+	void **objs = calloc( PEAK_OBJECTS, sizeof( void* ) );
+	if( objs == NULL ) {
+		fprintf( stderr, "out of memory\n" );
+		exit( 1 );
+	}
+
+	for( unsigned int cyc = 0; cyc < PEAK_OBJECTS; ++cyc )
+		objs[ cyc ] = pool_object_alloc( c );
+
+	printf( "%s: peak %zu slabs\n", name, c->nslabs );
+
+	srand( 42 );
+	void *hint = NULL;
+	unsigned int live = PEAK_OBJECTS;
+	size_t total = 0;
+	for( unsigned int round = 0; round < ROUNDS; ++round ) {
+		// working set shrinks down to 1/8 of the peak
+		unsigned int target = PEAK_OBJECTS -
+			( PEAK_OBJECTS - PEAK_OBJECTS / 8 ) * ( round + 1 ) / ROUNDS;
+
+		for( unsigned int cyc = 0; cyc < CHURN_PER_ROUND; ++cyc ) {
+			unsigned int idx = ( unsigned int ) rand() % PEAK_OBJECTS;
+
+			if( objs[ idx ] != NULL ) {
+				hint = objs[ idx ];
+				if( pool_object_put( c, objs[ idx ] ) != NULL ) {
+					fprintf( stderr, "object is still referenced\n" );
+					exit( 1 );
+				}
+
+				objs[ idx ] = NULL;
+				--live;
+			} else if( live < target ) {
+				objs[ idx ] = last_released ?
+					pool_object_alloc_near( c, hint ) :
+					pool_object_alloc( c );
+				++live;
+			}
+		}
+
+		pool_reap( c );
+		// hint may point to reaped slab now
+		hint = NULL;
+		total += c->nslabs;
+
+		if( ( ( round + 1 ) % REPORT_EVERY ) == 0 )
+			printf( "%s: round %u, live %u objects, %zu slabs\n",
+				name,
+				round,
+				live,
+				c->nslabs
+			);
+	}
+
+	for( unsigned int cyc = 0; cyc < PEAK_OBJECTS; ++cyc )
+		if( objs[ cyc ] != NULL )
+			pool_object_put( c, objs[ cyc ] );
+
+	free( objs );
+	pool_free( c );
+
+	return total / ROUNDS;
+}
+
+int main( void ) {
+	size_t fullest = _run( "fullest-first", 0 );
+	size_t last = _run( "last-released", 1 );
+
+	printf( "average slabs after reaping: fullest-first %zu, "
+		"last-released %zu (%.1f%% less)\n",
+		fullest,
+		last,
+		( last != 0 ) ? 100.0 * ( ( double ) last - fullest ) / last : 0.0
+	);
+
+	return 0;
+}
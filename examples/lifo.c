@@ -0,0 +1,120 @@
+#define _GNU_SOURCE
+
+#include <mempool.h>
+#include <mempool/simple.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+// alloc -> touch -> free loop over working set which doesn't fit into L2.
+// Each iteration releases random live object right after touching it and
+// allocates a new one. With SLAB_LIFO the new object is the one just
+// released, so it's still warm; otherwise the first free slot of the fullest
+// chunk is handed out, which is usually cold. L1D and last level cache misses
+// are counted with perf events (may be unavailable in containers; then only
+// time is reported).
+
+#define OBJ_SIZE 256
+#define LIVE_OBJECTS ( 1u << 16 )
+#define ITERATIONS ( 1u << 24 )
+
+static int _open_counter( unsigned int type, unsigned long long config ) {
+	struct perf_event_attr attr;
+	memset( &attr, 0, sizeof( attr ) );
+	attr.size = sizeof( attr );
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return ( int ) syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 );
+}
+
+static unsigned long long _read_counter( int fd ) {
+	unsigned long long v = 0;
+	if( ( fd < 0 ) || ( read( fd, &v, sizeof( v ) ) != sizeof( v ) ) )
+		return 0;
+
+	return v;
+}
+
+static void _run( const char *name, unsigned int options ) {
+	static slab_class_t sclass = {
+		.blk_sz = OBJ_SIZE,
+		.align = 64,
+		.ctag = NULL,
+		.ctor = NULL,
+		.dtor = NULL,
+		.reinit = NULL
+	};
+
+	cache_t *c = pool_simple_create( options, &sclass, LIVE_OBJECTS );
+	void **objs = malloc( sizeof( void* ) * LIVE_OBJECTS );
+	assert( objs != NULL );
+
+	for( unsigned int cyc = 0; cyc < LIVE_OBJECTS; ++cyc ) {
+		objs[ cyc ] = pool_object_alloc( c );
+		memset( objs[ cyc ], 0, OBJ_SIZE );
+	}
+
+	int l1d = _open_counter( PERF_TYPE_HW_CACHE,
+		PERF_COUNT_HW_CACHE_L1D |
+			( PERF_COUNT_HW_CACHE_OP_WRITE << 8 ) |
+			( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 )
+	);
+	int llc = _open_counter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES );
+
+	ioctl( l1d, PERF_EVENT_IOC_ENABLE, 0 );
+	ioctl( llc, PERF_EVENT_IOC_ENABLE, 0 );
+
+	struct timespec start, stop;
+	clock_gettime( CLOCK_MONOTONIC, &start );
+
+	unsigned int seed = 42;
+	for( unsigned int cyc = 0; cyc < ITERATIONS; ++cyc ) {
+		unsigned int idx = rand_r( &seed ) % LIVE_OBJECTS;
+
+		// object is touched by client right before it's released
+		memset( objs[ idx ], ( int ) cyc, OBJ_SIZE );
+		pool_object_put( c, objs[ idx ] );
+
+		objs[ idx ] = pool_object_alloc( c );
+		memset( objs[ idx ], ( int ) cyc, OBJ_SIZE );
+	}
+
+	clock_gettime( CLOCK_MONOTONIC, &stop );
+	ioctl( l1d, PERF_EVENT_IOC_DISABLE, 0 );
+	ioctl( llc, PERF_EVENT_IOC_DISABLE, 0 );
+
+	printf( "%s: %.1f ns/iter, L1D misses %llu, LLC misses %llu\n",
+		name,
+		( ( stop.tv_sec - start.tv_sec ) * 1e9 +
+			( stop.tv_nsec - start.tv_nsec ) ) / ITERATIONS,
+		_read_counter( l1d ),
+		_read_counter( llc )
+	);
+
+	if( l1d >= 0 )
+		close( l1d );
+
+	if( llc >= 0 )
+		close( llc );
+
+	for( unsigned int cyc = 0; cyc < LIVE_OBJECTS; ++cyc )
+		pool_object_put( c, objs[ cyc ] );
+
+	free( objs );
+	pool_free( c );
+}
+
+int main( void ) {
+	_run( "first-free", 0 );
+	_run( "lifo", SLAB_LIFO );
+	return 0;
+}
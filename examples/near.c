@@ -0,0 +1,125 @@
+#include <mempool.h>
+#include <mempool/simple.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <assert.h>
+
+// Pointer chasing over binary search tree built from random keys. Tree nodes
+// are interleaved with allocations of unrelated objects from the same cache,
+// and the cache is fragmented beforehand, as it happens in long-running
+// process. With plain allocation nodes land wherever the fullest chunk has
+// room; with pool_object_alloc_near child is placed next to its parent when
+// possible, so depth-first traversal touches fewer cache lines and pages.
+
+#define NODES ( 1u << 20 )
+#define NOISE_PER_NODE 3
+#define TRAVERSALS 16
+
+typedef struct _node_t {
+	struct _node_t *left;
+	struct _node_t *right;
+	unsigned int key;
+	char payload[ 44 ];
+} node_t;
+
+static unsigned long long _sum( node_t *n ) {
+	unsigned long long ret = 0;
+
+	// explicit stack keeps recursion overhead out of measurement
+	static node_t *stack[ NODES ];
+	unsigned int top = 0;
+	if( n != NULL )
+		stack[ top++ ] = n;
+
+	while( top ) {
+		n = stack[ --top ];
+		ret += n->key;
+		if( n->right != NULL )
+			stack[ top++ ] = n->right;
+		if( n->left != NULL )
+			stack[ top++ ] = n->left;
+	}
+
+	return ret;
+}
+
+static void _run( const char *name, int near ) {
+	static slab_class_t sclass = {
+		.blk_sz = sizeof( node_t ),
+		.align = 0,
+		.ctag = NULL,
+		.ctor = NULL,
+		.dtor = NULL,
+		.reinit = NULL
+	};
+
+	cache_t *c = pool_simple_create( 0, &sclass, 0 );
+	unsigned int nnoise = NODES * NOISE_PER_NODE;
+	void **noise = malloc( sizeof( void* ) * nnoise );
+	assert( noise != NULL );
+
+	// fragmentation: half of objects is released in random order
+	unsigned int seed = 7;
+	for( unsigned int cyc = 0; cyc < nnoise; ++cyc )
+		noise[ cyc ] = pool_object_alloc( c );
+
+	for( unsigned int cyc = 0; cyc < nnoise; ++cyc )
+		if( rand_r( &seed ) & 1 ) {
+			pool_object_put( c, noise[ cyc ] );
+			noise[ cyc ] = NULL;
+		}
+
+	node_t *root = NULL;
+	for( unsigned int cyc = 0; cyc < NODES; ++cyc ) {
+		unsigned int key = rand_r( &seed );
+		node_t *parent = NULL, **link = &root;
+
+		while( *link != NULL ) {
+			parent = *link;
+			link = ( key < parent->key ) ?
+				&( parent->left ) :
+				&( parent->right );
+		}
+
+		node_t *n = near ? pool_object_alloc_near( c, parent ) :
+			pool_object_alloc( c );
+		n->left = n->right = NULL;
+		n->key = key;
+		*link = n;
+
+		// unrelated allocations of other parts of the program
+		for( unsigned int k = 0; k < NOISE_PER_NODE; ++k ) {
+			unsigned int idx = rand_r( &seed ) % nnoise;
+			if( noise[ idx ] != NULL )
+				pool_object_put( c, noise[ idx ] );
+
+			noise[ idx ] = pool_object_alloc( c );
+		}
+	}
+
+	struct timespec start, stop;
+	unsigned long long sum = 0;
+
+	clock_gettime( CLOCK_MONOTONIC, &start );
+	for( unsigned int cyc = 0; cyc < TRAVERSALS; ++cyc )
+		sum += _sum( root );
+	clock_gettime( CLOCK_MONOTONIC, &stop );
+
+	printf( "%s: %.2f ns/node (checksum %llu)\n",
+		name,
+		( ( stop.tv_sec - start.tv_sec ) * 1e9 +
+			( stop.tv_nsec - start.tv_nsec ) ) /
+			( ( double ) NODES * TRAVERSALS ),
+		sum
+	);
+
+	free( noise );
+	pool_free( c );
+}
+
+int main( void ) {
+	_run( "plain", 0 );
+	_run( "near", 1 );
+	return 0;
+}
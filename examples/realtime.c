@@ -0,0 +1,136 @@
+#define _GNU_SOURCE
+
+#include <mempool.h>
+#include <mempool/fixed.h>
+#include <sys/mman.h>
+#include <stdalign.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+// Fixed-capacity cache over static region. Memory backend calls are counted
+// by interposing allocation routines of C library: after the cache is created
+// there must be no calls at all. Worst-case latency of allocation and release
+// is measured over several fill/drain cycles including exhaustion.
+
+#define REGION_SIZE ( 1u << 20 )
+#define CYCLES 100
+
+extern void *__libc_malloc( size_t sz );
+extern void *__libc_calloc( size_t n, size_t sz );
+extern void *__libc_realloc( void *p, size_t sz );
+extern void *__libc_memalign( size_t align, size_t sz );
+extern void __libc_free( void *p );
+
+static int _G_counting = 0;
+static unsigned long _G_backend_calls = 0;
+
+void *malloc( size_t sz ) {
+	_G_backend_calls += _G_counting;
+	return __libc_malloc( sz );
+}
+
+void *calloc( size_t n, size_t sz ) {
+	_G_backend_calls += _G_counting;
+	return __libc_calloc( n, sz );
+}
+
+void *realloc( void *p, size_t sz ) {
+	_G_backend_calls += _G_counting;
+	return __libc_realloc( p, sz );
+}
+
+int posix_memalign( void **p, size_t align, size_t sz ) {
+	_G_backend_calls += _G_counting;
+	return ( ( *p = __libc_memalign( align, sz ) ) == NULL );
+}
+
+void free( void *p ) {
+	_G_backend_calls += _G_counting;
+	__libc_free( p );
+}
+
+static inline long long _now_ns( void ) {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+static void _ctor( void *obj, void *ctag ) {
+	memset( obj, 0, 48 );
+}
+
+int main( void ) {
+	static alignas( 64 ) char region[ REGION_SIZE ];
+	static void *objs[ REGION_SIZE / 48 ];
+	static slab_class_t sclass = {
+		.blk_sz = 48,
+		.align = 16,
+		.ctag = NULL,
+		.ctor = _ctor,
+		.dtor = NULL,
+		.reinit = NULL
+	};
+
+	// it's fine if we aren't allowed to lock memory
+	mlock( region, sizeof( region ) );
+
+	cache_t *c = pool_create_in( region, sizeof( region ), &sclass, 0 );
+	assert( c != NULL );
+
+	long long max_alloc = 0, max_put = 0;
+	unsigned int capacity = 0;
+
+	_G_counting = 1;
+	for( unsigned int cycle = 0; cycle < CYCLES; ++cycle ) {
+		unsigned int n = 0;
+
+		for( ;; ) {
+			long long start = _now_ns();
+			void *obj = pool_object_alloc( c );
+			long long spent = _now_ns() - start;
+
+			if( spent > max_alloc )
+				max_alloc = spent;
+
+			if( obj == NULL )
+				break;
+
+			assert( ( ( char* ) obj >= region ) &&
+				( ( char* ) obj < region + sizeof( region ) )
+			);
+			objs[ n++ ] = obj;
+		}
+
+		// exhaustion is deterministic
+		assert( ( cycle == 0 ) || ( n == capacity ) );
+		capacity = n;
+
+		// release in scattered order to exercise occupancy buckets
+		for( unsigned int step = 0; step < 7; ++step )
+			for( unsigned int cyc = step; cyc < n; cyc += 7 ) {
+				long long start = _now_ns();
+				pool_object_put( c, objs[ cyc ] );
+				long long spent = _now_ns() - start;
+
+				if( spent > max_put )
+					max_put = spent;
+			}
+	}
+	_G_counting = 0;
+
+	printf( "capacity %u objects, backend calls %lu, "
+		"max alloc %lld ns, max put %lld ns\n",
+		capacity,
+		_G_backend_calls,
+		max_alloc,
+		max_put
+	);
+
+	assert( capacity > 0 );
+	assert( _G_backend_calls == 0 );
+
+	pool_free( c );
+	return 0;
+}
@@ -5,7 +5,18 @@ static void _pool_init( cache_t *cache,
 	unsigned int inum
 ) {
 	assert( slab_class->blk_sz > 0 );
-	assert( !( options & ( ~SLAB_REFERABLE ) ) );
+	assert(
+		!( options & ( ~(
+			SLAB_REFERABLE | SLAB_HUGE_PAGES | SLAB_LIFO | SLAB_ZERO |
+				SLAB_NO_MERGE | SLAB_HANDLES | SLAB_HANDLE_GEN
+		) ) )
+	);
+	assert( !( options & SLAB_ZERO ) || (
+		( slab_class->ctor == NULL ) &&
+		( slab_class->ctor_bulk == NULL ) &&
+		( slab_class->reinit == NULL ) &&
+		( slab_class->reinit_bulk == NULL )
+	) );
 	assert( cache != NULL );
 	assert( slab_class != NULL );
 	assert( cache_class != NULL );
@@ -17,12 +28,13 @@ static void _pool_init( cache_t *cache,
 		cache->blk_sz = _adjust_align( cache->blk_sz, COUNTER_ALIGN ) +
 			COUNTER_SIZE;
 
-	// adjust block size to match alignment
-	cache->blk_sz = _adjust_align( cache->blk_sz, cache->align );
-
 	cache->align = ( slab_class->align == 0 ) ? sizeof( void* ) :
 		slab_class->align;
 
+	// adjust block size to match alignment
+	cache->blk_sz = _adjust_align( cache->blk_sz, cache->align );
+
+	cache->options = options;
 	cache->slab_class = *slab_class;
 	cache->cache_class = *cache_class;
 
@@ -30,6 +42,26 @@ static void _pool_init( cache_t *cache,
 	// then we should consider alignment restrictions and add padding
 	cache->header_sz = _adjust_align( sizeof( slab_t ), cache->align );
 	cache->init_sz = inum;
+	cache->refs = 1;
+
+	// SLAB chunks are requested from memory backend unless huge page arena
+	// has been asked for and it's able to host chunks of such size
+	cache->slab_source = _G_backend_source;
+	if( options & SLAB_HUGE_PAGES )
+		_huge_source_init( cache );
+
+	// chunk table is allocated along with the first chunk, so there is
+	// nothing to fail here
+	if( options & SLAB_HANDLE_GEN )
+		cache->options |= SLAB_HANDLES;
+
+	if( cache->options & SLAB_HANDLES ) {
+		cache->handles_bits = 32 - POOL_HANDLE_SLOT_BITS -
+			( ( options & SLAB_HANDLE_GEN ) ? POOL_HANDLE_GEN_BITS : 0 );
+		cache->handles_next = 1;
+		cache->handles = NULL;
+		cache->handles_cap = 0;
+	}
 }
 
 static void _prepopulate_list( cache_t *cache,
@@ -42,8 +74,10 @@ static void _prepopulate_list( cache_t *cache,
 
 	slab_t *ret = _alloc_slab( cache );
 	slab_t *cur = ret;
-	for( unsigned int cyc = 0; cyc < nbuckets; ++cyc ) {
-		cur->next = _alloc_slab( cache );
+	for( unsigned int cyc = 0; ( cur != NULL ) && ( cyc < nbuckets ); ++cyc ) {
+		if( ( cur->next = _alloc_slab( cache ) ) == NULL )
+			break;
+
 		cur->next->prev = cur;
 		cur = cur->next;
 	}
@@ -54,27 +88,292 @@ static void _prepopulate_list( cache_t *cache,
 		*tail = cur;
 }
 
-static inline slab_t *_alloc_slab( cache_t *cache ) {
-	assert( nslots <= SLOTS_NUM );
-	assert( nslots > 0 );
-	
-	slab_t *ret = NULL;
+static void *_backend_slab_alloc( void *arena, size_t sz, size_t align ) {
+	void *ret = NULL;
 
-	// TODO: handle errors
-	assert(
-		posix_memalign( ( void** ) &ret,
-			SLAB_ALIGNMENT,
-			cache->header_sz + cache->blk_sz * SLOTS_NUM
-		) == 0
+	if( posix_memalign( &ret, align, sz ) )
+		return NULL;
+
+	return ret;
+}
+
+static void _backend_slab_free( void *arena, void *slab ) {
+	free( slab );
+}
+
+static slab_source_t _G_backend_source = {
+	.slab_alloc = _backend_slab_alloc,
+	.slab_free = _backend_slab_free,
+	.arena_destroy = NULL,
+	.zeroed = 0,
+	.concurrent = 1,
+	.arena = NULL
+};
+
+// budget is accounted on SLAB creation/destruction only; relaxed atomics are
+// enough since zones may create SLABs simultaneously but nothing is ordered
+// by the counter
+static inline int _charge_slab( cache_t *cache ) {
+	size_t max = __atomic_load_n( &( cache->max_slabs ), __ATOMIC_RELAXED );
+	size_t n = __atomic_add_fetch( &( cache->nslabs ), 1, __ATOMIC_RELAXED );
+
+	if( max && ( n > max ) ) {
+		__atomic_sub_fetch( &( cache->nslabs ), 1, __ATOMIC_RELAXED );
+		return 0;
+	}
+
+	return 1;
+}
+
+static inline void _uncharge_slab( cache_t *cache ) {
+	__atomic_sub_fetch( &( cache->nslabs ), 1, __ATOMIC_RELAXED );
+}
+
+static inline int _is_over_budget( cache_t *cache ) {
+	size_t max = __atomic_load_n( &( cache->max_slabs ), __ATOMIC_RELAXED );
+
+	return max &&
+		( __atomic_load_n( &( cache->nslabs ), __ATOMIC_RELAXED ) >= max );
+}
+
+_Static_assert( SLOTS_NUM == ( 1u << POOL_HANDLE_SLOT_BITS ),
+	"slot number doesn't fit into handle"
+);
+
+static inline pool_handle_entry_t *_get_handle_entry( cache_t *cache,
+	unsigned int idx
+) {
+	pool_handle_entry_t **table =
+		__atomic_load_n( &( cache->handles ), __ATOMIC_ACQUIRE );
+
+	return &( table[ idx >> POOL_HANDLE_BLOCK_SHIFT ]
+		[ idx & ( ( 1u << POOL_HANDLE_BLOCK_SHIFT ) - 1 ) ] );
+}
+
+// chunk table is modified on SLAB creation and destruction only, which may
+// happen in several zones simultaneously; spinning is cheap compared with
+// the rest of those slow paths
+static inline void _lock_handles( cache_t *cache ) {
+	while( __atomic_exchange_n( &( cache->handles_lock ),
+		1,
+		__ATOMIC_ACQUIRE
+	) )
+		;
+}
+
+static inline void _unlock_handles( cache_t *cache ) {
+	__atomic_store_n( &( cache->handles_lock ), 0, __ATOMIC_RELEASE );
+}
+
+// handles lock is held; the first level of chunk table is sized for chunks
+// reserved at creation initially and doubled when it's outgrown; lockless
+// dereferencing may still read the old one, so it's chained (the leading
+// entry of each first level links the previous one) and freed with cache
+static int _grow_handles( cache_t *cache ) {
+	unsigned int max = ( 1u << cache->handles_bits ) >>
+		POOL_HANDLE_BLOCK_SHIFT;
+	unsigned int cap = ( cache->handles_cap != 0 ) ?
+		( cache->handles_cap * 2 ) :
+		( ( ( cache->init_sz / SLOTS_NUM + 1 ) >> POOL_HANDLE_BLOCK_SHIFT ) +
+			1 );
+	if( cap > max )
+		cap = max;
+
+	pool_handle_entry_t **base = calloc( cap + 1,
+		sizeof( pool_handle_entry_t* )
 	);
+	if( base == NULL )
+		return 0;
+
+	if( cache->handles != NULL ) {
+		base[ 0 ] = ( void* ) ( cache->handles - 1 );
+		memcpy( base + 1,
+			cache->handles,
+			cache->handles_cap * sizeof( pool_handle_entry_t* )
+		);
+	}
+
+	__atomic_store_n( &( cache->handles ), base + 1, __ATOMIC_RELEASE );
+	cache->handles_cap = cap;
+
+	return 1;
+}
+
+// assigns table index to SLAB; returns 0 if table is full or can't grow
+static int _attach_handles( cache_t *cache, slab_t *slab ) {
+	unsigned int idx = 0;
+	pool_handle_entry_t *e = NULL;
+
+	_lock_handles( cache );
+
+	if( cache->handles_free ) {
+		idx = cache->handles_free;
+		e = _get_handle_entry( cache, idx );
+		cache->handles_free = e->next_free;
+	} else if( cache->handles_next < ( 1u << cache->handles_bits ) ) {
+		idx = cache->handles_next;
+		if( ( ( idx >> POOL_HANDLE_BLOCK_SHIFT ) >= cache->handles_cap ) &&
+			! _grow_handles( cache )
+		) {
+			_unlock_handles( cache );
+			return 0;
+		}
+
+		pool_handle_entry_t **block =
+			&( cache->handles[ idx >> POOL_HANDLE_BLOCK_SHIFT ] );
+
+		if( ( *block == NULL ) && ( ( *block = calloc(
+				1u << POOL_HANDLE_BLOCK_SHIFT,
+				sizeof( pool_handle_entry_t )
+			) ) == NULL )
+		) {
+			_unlock_handles( cache );
+			return 0;
+		}
+
+		++( cache->handles_next );
+		e = _get_handle_entry( cache, idx );
+	}
+
+	if( e != NULL ) {
+		e->slab = slab;
+		slab->index = idx;
+	}
+
+	_unlock_handles( cache );
+
+	return e != NULL;
+}
+
+// index is recycled; handles of SLAB become stale if generations are on
+static void _detach_handles( cache_t *cache, slab_t *slab ) {
+	pool_handle_entry_t *e = _get_handle_entry( cache, slab->index );
+
+	_lock_handles( cache );
+
+	e->slab = NULL;
+	for( unsigned int cyc = 0; cyc < SLOTS_NUM; ++cyc )
+		++( e->gen[ cyc ] );
+
+	e->next_free = cache->handles_free;
+	cache->handles_free = slab->index;
+
+	_unlock_handles( cache );
+}
+
+static void _handles_destroy( cache_t *cache ) {
+	for( unsigned int cyc = 0; cyc < cache->handles_cap; ++cyc )
+		free( cache->handles[ cyc ] );
+
+	pool_handle_entry_t **base = cache->handles - 1;
+	while( base != NULL ) {
+		pool_handle_entry_t **prev = ( void* ) base[ 0 ];
+		free( base );
+		base = prev;
+	}
+
+	cache->handles = NULL;
+}
+
+// the last holder tears the cache down; chunk source and chunk table are
+// needed by the cache class to free its chunks, so they go after
+void _pool_unref( cache_t *cache ) {
+	if( __atomic_sub_fetch( &( cache->refs ), 1, __ATOMIC_ACQ_REL ) )
+		return;
+
+	cache->cache_class.pool_destroy( cache );
+
+	if( cache->slab_source.arena_destroy != NULL )
+		cache->slab_source.arena_destroy( cache->slab_source.arena );
+
+	if( cache->handles != NULL )
+		_handles_destroy( cache );
+
+	free( cache );
+}
+
+slab_t *_alloc_slab( cache_t *cache ) {
+	if( ! _charge_slab( cache ) )
+		return NULL;
+
+	POOL_TIMER_START( started );
+
+	slab_t *ret = cache->slab_source.slab_alloc( cache->slab_source.arena,
+		_get_slab_size( cache ),
+		_get_slab_align( cache )
+	);
+
+	if( ret == NULL ) {
+		_uncharge_slab( cache );
+		return NULL;
+	}
 
 	memset( ret, 0, sizeof( slab_t ) );
 	ret->map = EMPTY_MAP;
+	ret->serial = __atomic_add_fetch( &( cache->slab_serial ),
+		1,
+		__ATOMIC_RELAXED
+	);
+
+	// all slots of zeroing cache are clean after that; chunks which come
+	// zero-filled from the source are left alone
+	if( ( cache->options & SLAB_ZERO ) && ( ! cache->slab_source.zeroed ) )
+		memset( ( ( char* ) ret ) + cache->header_sz,
+			0,
+			cache->blk_sz * SLOTS_NUM
+		);
+
+	ret->zmap = EMPTY_MAP;
+
+	if( ( cache->options & SLAB_HANDLES ) && ! _attach_handles( cache, ret ) ) {
+		cache->slab_source.slab_free( cache->slab_source.arena, ret );
+		_uncharge_slab( cache );
+		return NULL;
+	}
+
+	_init_slots( cache, ret );
+
+	POOL_TIMER_STOP( cache, POOL_SLAB_ALLOC, started );
+	POOL_PROBE2( slab__alloc, cache, ret );
+
+	return ret;
+}
+
+// constructs objects and fills service fields of slots; SLAB header is left
+// untouched
+static inline void _init_slots( cache_t *cache, slab_t *slab ) {
+	unsigned char *cur = NULL;
+
+	if( ( cache->slab_class.ctor != NULL ) ||
+		( cache->slab_class.ctor_bulk != NULL )
+	) {
+		POOL_PROBE2( ctor__start, cache, slab );
+		POOL_TIMER_START( started );
+
+		// invoke constructor for each object in SLAB if the case; batched
+		// constructor is preferred since it handles the whole SLAB at once
+		cur = ( ( unsigned char * ) slab ) + cache->header_sz;
+		if( cache->slab_class.ctor_bulk != NULL )
+			cache->slab_class.ctor_bulk( cur,
+				cache->blk_sz,
+				SLOTS_NUM,
+				cache->slab_class.ctag
+			);
+		else
+			for( unsigned char cyc = 0;
+				cyc < SLOTS_NUM;
+				++cyc, cur += cache->blk_sz
+			)
+				cache->slab_class.ctor( cur, cache->slab_class.ctag );
+
+		POOL_TIMER_STOP( cache, POOL_SLAB_CTOR, started );
+		POOL_PROBE2( ctor__done, cache, slab );
+	}
 
 	// Let's fill sequential numbers. They are additional byte-length values
-	// placed at the very end of slot.
-	unsigned char *cur = ( ( unsigned char * ) ret ) +
-		cache->header_sz + cache->blk_sz - 1;
+	// placed at the very end of slot. It's done after construction, so
+	// they are valid even if constructor has touched padding of slot.
+	cur = ( ( unsigned char * ) slab ) + cache->header_sz + cache->blk_sz - 1;
 	for( unsigned char cyc = 0;
 		cyc < SLOTS_NUM;
 		++cyc, cur += cache->blk_sz
@@ -85,18 +384,6 @@ static inline slab_t *_alloc_slab( cache_t *cache ) {
 	// the last slot; used during SLAB destruction to define how many times
 	// object destructor should be invoked
 	*( cur - cache->blk_sz ) |= SLAB_LIST_TERMINATOR;
-
-	if( cache->slab_class.ctor != NULL ) {
-		// invoke constructor for each object in SLAB if the case
-		cur = ( ( unsigned char * ) ret ) + cache->header_sz;
-		for( unsigned char cyc = 0;
-			cyc < SLOTS_NUM;
-			++cyc, cur += cache->blk_sz
-		)
-			cache->slab_class.ctor( cur, cache->slab_class.ctag );
-	}
-
-	return ret;
 }
 
 static inline size_t _adjust_align( size_t blk_sz, unsigned int align ) {
@@ -110,11 +397,19 @@ static inline size_t _adjust_align( size_t blk_sz, unsigned int align ) {
 	return blk_sz;
 }
 
-void _free_slab( slab_t *slab,
-	void ( *dtor )( void *obj, void *ctag ),
-	void *ctag
-) {
-	if( dtor != NULL ) {
+void _free_slab( cache_t *cache, slab_t *slab ) {
+	void ( *dtor )( void *obj, void *ctag ) = cache->slab_class.dtor;
+	void *ctag = cache->slab_class.ctag;
+
+	if( cache->slab_class.dtor_bulk != NULL )
+		// every SLAB has SLOTS_NUM slots, so terminator needn't be looked for
+		cache->slab_class.dtor_bulk(
+			( ( unsigned char * ) slab ) + cache->header_sz,
+			cache->blk_sz,
+			SLOTS_NUM,
+			ctag
+		);
+	else if( dtor != NULL ) {
 		// destroy all object if the case
 		unsigned char *cur = ( ( unsigned char * ) slab ) + cache->header_sz;
 		// this one is pointer to sequence number of the current slot
@@ -129,7 +424,11 @@ void _free_slab( slab_t *slab,
 		dtor( cur, ctag );
 	}
 
-	free( slab );
+	if( cache->options & SLAB_HANDLES )
+		_detach_handles( cache, slab );
+
+	cache->slab_source.slab_free( cache->slab_source.arena, slab );
+	_uncharge_slab( cache );
 }
 
 static inline void _reset_refcount( cache_t *cache, void *blk ) {
@@ -145,73 +444,328 @@ static inline counter_t _dec_refcount( cache_t *cache, void *blk ) {
 	return --( *( _get_counter_ptr( cache, blk ) ) );
 }
 
-static inline void *_get_block( cache_t *c ) {
-	assert( c->head->map );
+static inline void *_get_block( cache_t *c, slab_t *s ) {
+	assert( s->map );
 
-	slab_t *s = c->head;
 	// find the first bit set in the map; it will be sequence number
-	// of the first unallocated slot
+	// of the first unallocated slot; slot released last goes first if
+	// LIFO policy is requested
 	int slotn = ffs( ( int ) s->map ) - 1;
+	if( ( c->options & SLAB_LIFO ) && ( s->map & ( 1u << s->hot ) ) )
+		slotn = s->hot;
+
 	// set corresponding map bit to 1
 	s->map &= ~( 1u << slotn );
+
+	char *base = ( ( char *) s ) + c->header_sz;
+	if( c->options & SLAB_ZERO ) {
+		// slot handed out before is considered dirty; it's cleared here
+		// rather than on release since it may be reaped without reuse
+		if( !( s->zmap & ( 1u << slotn ) ) )
+			memset( base + c->blk_sz * slotn, 0, c->slab_class.blk_sz );
+
+		s->zmap &= ~( 1u << slotn );
+	}
+
+	if( ( c->options & SLAB_LIFO ) && s->map )
+		// the next allocation from this SLAB will likely hand out
+		// the first free slot; let's warm it up
+		__builtin_prefetch( base + c->blk_sz * ( ffs( ( int ) s->map ) - 1 ),
+			1
+		);
 	
-	return ( ( ( char *) s ) + c->header_sz + ( c->blk_sz * slotn ) );
+	return ( base + ( c->blk_sz * slotn ) );
+}
+
+static inline unsigned int _get_slot_num( cache_t *cache, void *obj ) {
+	// get the sequence number and rid off terminator bit
+	return ( *( ( ( unsigned char* ) obj ) + cache->blk_sz - 1 ) ) &
+		( ~ SLAB_LIST_TERMINATOR );
+}
+
+static inline slab_t *_get_slab( cache_t *cache, void *obj ) {
+	// calculating slab header memory address
+	return ( slab_t* ) (
+		( ( unsigned char* ) obj ) -
+			cache->blk_sz * _get_slot_num( cache, obj ) -
+			cache->header_sz
+	);
+}
+
+static inline void _release_slab_list( cache_t *cache, slab_list_t *sl ) {
+	if( cache->cache_class.release_slab_list != NULL )
+		cache->cache_class.release_slab_list( cache, sl );
+}
+
+// moves chunks built by refiller to the list of free chunks; the whole
+// reserve is taken at once, so there is no ABA problem with concurrent takers
+static inline int _take_reserve( cache_t *cache, slab_list_t *sl ) {
+	if( __atomic_load_n( &( cache->reserve ), __ATOMIC_RELAXED ) == NULL )
+		return 0;
+
+	slab_t *s = __atomic_exchange_n( &( cache->reserve ),
+		NULL,
+		__ATOMIC_ACQUIRE
+	);
+	if( s == NULL )
+		return 0;
+
+	unsigned int n = 0;
+	for( slab_t *next = NULL; s != NULL; s = next, ++n ) {
+		next = s->next;
+		_link_slab( &( sl->free_list ), s );
+	}
+
+	__atomic_sub_fetch( &( cache->nreserved ), n, __ATOMIC_RELAXED );
+
+	// refiller may be detached and destroyed meanwhile; detaching clears
+	// the pointer first and then waits for wakers which have seen it
+	__atomic_add_fetch( &( cache->refiller_wakers ), 1, __ATOMIC_SEQ_CST );
+	struct _refiller_t *r =
+		__atomic_load_n( &( cache->refiller ), __ATOMIC_SEQ_CST );
+	if( r != NULL )
+		_refiller_wake( r );
+
+	__atomic_sub_fetch( &( cache->refiller_wakers ), 1, __ATOMIC_RELEASE );
+
+	return 1;
+}
+
+// takes block from the SLAB which has free slots and moves the SLAB to
+// the list matching its new occupancy
+static inline void *_take_block( cache_t *cache, slab_list_t *sl, slab_t *s ) {
+	unsigned int nfree = _get_free_slots( s );
+	void *ret = _get_block( cache, s );
+	_refile_slab( sl, s, nfree, nfree - 1 );
+
+	if( cache->options & SLAB_REFERABLE )
+		_reset_refcount( cache, ret );
+
+	return ret;
+}
+
+// takes block from the slab list; the list must be acquired already
+static inline void *_alloc_block( cache_t *cache, slab_list_t *sl ) {
+	// the fullest of partially filled SLABs is always picked; nearly empty
+	// ones are left alone so they can drain and be reaped later; the only
+	// exception is LIFO policy: SLAB where block has been released last is
+	// picked while that block is still free since it's likely to be warm
+	slab_t *s = sl->hot;
+	if( ( !( cache->options & SLAB_LIFO ) ) ||
+		( s == NULL ) ||
+		( !( s->map & ( 1u << s->hot ) ) )
+	)
+		s = _get_fullest_slab( sl );
+
+	if( s == NULL ) {
+		// there is no partially filled SLAB; take absolutely free one
+		// or allocate new SLAB chunk if there are no free ones and
+		// refiller hasn't prepared any
+		if( ( sl->free_list == NULL ) && ( ! _take_reserve( cache, sl ) ) ) {
+			slab_t *news = _alloc_slab( cache );
+			if( news == NULL )
+				return NULL;
+
+			_link_slab( &( sl->free_list ), news );
+		}
+
+		s = sl->free_list;
+		POOL_PROBE2( slab__elect, cache, s );
+	}
+
+	return _take_block( cache, sl, s );
+}
+
+// outstanding handles of released blocks become stale; it's done when
+// block is released by client, so blocks parked in per-thread magazines or
+// SPSC ring don't get bumped again on their way back to the SLAB
+static inline void _expire_handles( cache_t *cache,
+	slab_t *s,
+	blockmap_t released
+) {
+	if( !( cache->options & SLAB_HANDLE_GEN ) )
+		return;
+
+	pool_handle_entry_t *e = _get_handle_entry( cache, s->index );
+	for( ; released; released &= released - 1 )
+		++( e->gen[ ffs( ( int ) released ) - 1 ] );
+}
+
+static inline void _expire_handle( cache_t *cache, void *obj ) {
+	_expire_handles( cache,
+		_get_slab( cache, obj ),
+		1u << _get_slot_num( cache, obj )
+	);
+}
+
+// marks recycled block as free in its SLAB; the list must be acquired
+// already
+static inline void _release_block( cache_t *cache,
+	slab_list_t *sl,
+	void *obj
+) {
+	unsigned int pos = _get_slot_num( cache, obj );
+	slab_t *cur = _get_slab( cache, obj );
+	unsigned int nfree = _get_free_slots( cur );
+
+	// set corresponding bit in map and move SLAB to the list which
+	// matches its new occupancy; if SLAB becomes absolutely free then
+	// it goes to free list and will be evicted during reaping
+	cur->map |= 1u << pos;
+	_refile_slab( sl, cur, nfree, nfree + 1 );
+
+	if( cache->options & SLAB_LIFO ) {
+		cur->hot = pos;
+		sl->hot = cur;
+	}
+}
+
+// returns block to the slab list it belongs to; the list must be acquired
+// already
+static inline void *_put_block( cache_t *cache, slab_list_t *sl, void *obj ) {
+	if( ( !( cache->options & SLAB_REFERABLE ) ) ||
+		( !_dec_refcount( cache, obj ) )
+	) {
+		if( cache->slab_class.reinit != NULL )
+			cache->slab_class.reinit( obj, cache->slab_class.ctag );
+
+		_expire_handle( cache, obj );
+		_release_block( cache, sl, obj );
+
+		return NULL;
+	}
+
+	return obj;
+}
+
+static inline void *_object_alloc( cache_t *cache ) {
+	if( cache->cache_class.object_alloc != NULL )
+		return cache->cache_class.object_alloc( cache );
+
+	// what would you do if the cache is freed already? NULL is a way
+	// to get an idea about this fact
+	slab_list_t *sl = cache->cache_class.get_slab_list( cache );
+	if( sl == NULL )
+		return NULL;
+
+	void *ret = _alloc_block( cache, sl );
+
+	_release_slab_list( cache, sl );
+
+	return ret;
+}
+
+// budget is exhausted; own free SLABs go first, then client is asked
+static int _relieve_pressure( cache_t *cache, cache_t *owner ) {
+	pool_reap( cache );
+
+	if( ! _is_over_budget( owner ) )
+		return 1;
+
+	return ( owner->pressure != NULL ) &&
+		owner->pressure( cache, owner->pressure_arg );
 }
 
 // mark object as allocated and increment reference number if the case
 void *pool_object_alloc( cache_t *cache ) {
 	assert( cache != NULL );
 
-	#if LIBMEMPOOL_MULTITHREADED
-		if( pthread_mutex_lock( &( cache->protect ) ) )
-			return NULL;
-	#endif
-
-	// do we have allocated head? if not the n we should allocate it
-	if( cache->head != NULL ) {
-		// is head empty?
-		if( ! cache->head->map ) {
-			// if yes, we should elect new head with free slots
-			// does the next SLAB exists?
-			if( cache->head->next == NULL ) {
-				// No. we have just one SLAB in cache.
-				cache->head = _alloc_slab( cache, SLOTS_NUM );
-				cache->head->next = cache->tail;
-				cache->tail->prev = cache->head;
-			} else {
-				// OK. we got it.
-				// does the next one have some free slots?
-				if( cache->head->next->map ) {
-					// YEP. just elect it as new head; former head goes to
-					// the tail; thereby all full SLABs are accumulated at
-					// the end of SLAB list
-					slab_t *oldhead = cache->head,
-						*oldtail = cache->tail,
-						*newhead = oldhead->next;
-					( oldtail->next = oldhead )->prev = oldtail;
-					( cache->tail = oldhead )->next = NULL;
-					( cache->head = newhead )->prev = NULL;
-				} else {
-					// NOPE. As far as separation of full SLABs and SLABs which
-					// have free slots is being maintaining continuosly then
-					// we won't have any chance to find something further; we
-					// should allocate new SLAB chunk and elect it as new head.
-					slab_t *news = _alloc_slab( cache, SLOTS_NUM );
-					( news->next = cache->head )->prev = news;
-					cache->head = news;
-				}
-			}
+	void *ret = _object_alloc( cache );
+
+	// the only retry is made if budget is the reason of failure
+	cache_t *owner = _get_chunk_owner( cache );
+	if( ( ret == NULL ) && _is_over_budget( owner ) &&
+		_relieve_pressure( cache, owner )
+	)
+		ret = _object_alloc( cache );
+
+	if( ret != NULL )
+		POOL_TRACE( POOL_TRACE_ALLOC, cache, ret, cache->slab_class.blk_sz );
+
+	return ret;
+}
+
+pool_handle_t pool_object_handle( cache_t *cache, void *obj ) {
+	assert( cache != NULL );
+	assert( cache->options & SLAB_HANDLES );
+	assert( obj != NULL );
+
+	unsigned int pos = _get_slot_num( cache, obj );
+	unsigned int idx = _get_slab( cache, obj )->index;
+	pool_handle_t ret = ( idx << POOL_HANDLE_SLOT_BITS ) | pos;
+
+	if( cache->options & SLAB_HANDLE_GEN )
+		ret |= ( ( pool_handle_t )
+			_get_handle_entry( cache, idx )->gen[ pos ] ) <<
+				( 32 - POOL_HANDLE_GEN_BITS );
+
+	return ret;
+}
+
+pool_handle_t pool_object_alloc_h( cache_t *cache ) {
+	void *obj = pool_object_alloc( cache );
+
+	return ( obj == NULL ) ? POOL_HANDLE_NULL :
+		pool_object_handle( cache, obj );
+}
+
+int pool_object_put_h( cache_t *cache, pool_handle_t h ) {
+	assert( cache != NULL );
+	assert( cache->options & SLAB_HANDLES );
+
+	void *obj = pool_handle_deref( cache, h );
+	if( obj == NULL )
+		return -1;
+
+	return pool_object_put( cache, obj ) != NULL;
+}
+
+// SLAB of the hint if it has free slots; otherwise the closest one among
+// heads of partial lists; scanning is bounded by the number of buckets
+static inline slab_t *_get_near_slab( slab_list_t *sl, slab_t *hs ) {
+	if( hs->map )
+		return hs;
+
+	slab_t *ret = NULL;
+	uintptr_t best = UINTPTR_MAX;
+	for( unsigned int cyc = 0; cyc < PARTIAL_BUCKETS_NUM; ++cyc ) {
+		slab_t *s = sl->partial_list[ cyc ];
+		if( s == NULL )
+			continue;
+
+		uintptr_t d = ( s > hs ) ?
+			( ( uintptr_t ) s - ( uintptr_t ) hs ) :
+			( ( uintptr_t ) hs - ( uintptr_t ) s );
+		if( d < best ) {
+			best = d;
+			ret = s;
 		}
-	} else
-		cache->head = cache->tail = _alloc_slab( cache, SLOTS_NUM );
+	}
 
-	void *ret = _get_block( cache );
-	if( cache->options & SLAB_REFERABLE )
-		_reset_refcount( cache, ret );
+	return ret;
+}
+
+void *pool_object_alloc_near( cache_t *cache, void *hint ) {
+	assert( cache != NULL );
+
+	if( ( hint == NULL ) || ( cache->cache_class.object_alloc != NULL ) )
+		return pool_object_alloc( cache );
+
+	slab_list_t *sl = cache->cache_class.get_slab_list( cache );
+	if( sl == NULL )
+		return NULL;
+
+	// the same arithmetic pool_object_put uses
+	slab_t *s = _get_near_slab( sl, _get_slab( cache, hint ) );
+	void *ret = ( s != NULL ) ? _take_block( cache, sl, s ) : NULL;
+
+	_release_slab_list( cache, sl );
+
+	// new SLAB is needed anyway; there is no locality to care about
+	if( ret == NULL )
+		return pool_object_alloc( cache );
 
-	#if LIBMEMPOOL_MULTITHREADED
-		pthread_mutex_unlock( &( cache->protect ) );
-	#endif
+	POOL_TRACE( POOL_TRACE_ALLOC, cache, ret, cache->slab_class.blk_sz );
 
 	return ret;
 }
@@ -221,17 +775,19 @@ void *pool_object_get( cache_t *cache, void *obj ) {
 	assert( cache != NULL );
 	assert( obj != NULL );
 
-	#if LIBMEMPOOL_MULTITHREADED
-		if( pthread_mutex_lock( &( cache->protect ) ) )
+	POOL_TRACE( POOL_TRACE_GET, cache, obj, 0 );
+
+	if( cache->cache_class.object_get != NULL )
+		return cache->cache_class.object_get( cache, obj );
+
+	if( cache->options & SLAB_REFERABLE ) {
+		slab_list_t *sl = cache->cache_class.get_slab_list( cache );
+		if( sl == NULL )
 			return NULL;
-	#endif
-	
-	if( cache->options & SLAB_REFERABLE )
-		_inc_refcount( cache, obj );
 
-	#if LIBMEMPOOL_MULTITHREADED
-		pthread_mutex_unlock( &( cache->protect ) );
-	#endif
+		_inc_refcount( cache, obj );
+		_release_slab_list( cache, sl );
+	}
 
 	return obj;
 }
@@ -242,51 +798,488 @@ void *pool_object_put( cache_t *cache, void *obj ) {
 	assert( cache != NULL );
 	assert( obj != NULL );
 
-	#if LIBMEMPOOL_MULTITHREADED
-		if( pthread_mutex_lock( &( cache->protect ) ) )
-			return NULL;
-	#endif
+	POOL_TRACE( POOL_TRACE_PUT, cache, obj, 0 );
 
-	if( ( !( cache->options & SLAB_REFERABLE ) ) ||
-		( !_dec_refcount( cache, obj ) )
+	if( cache->cache_class.object_put != NULL )
+		return cache->cache_class.object_put( cache, obj );
+
+	slab_list_t *sl = cache->cache_class.get_slab_list( cache );
+	if( sl == NULL )
+		return NULL;
+
+	obj = _put_block( cache, sl, obj );
+
+	_release_slab_list( cache, sl );
+
+	return obj;
+}
+
+// acquires slab list with index idx; caches with the single list have
+// only index 0
+static inline slab_list_t *_get_slab_list_at( cache_t *cache,
+	unsigned int idx
+) {
+	if( cache->cache_class.get_slab_list_at != NULL )
+		return cache->cache_class.get_slab_list_at( cache, idx );
+
+	return ( idx == 0 ) ? cache->cache_class.get_slab_list( cache ) : NULL;
+}
+
+// partially filled SLAB which is fuller than src; buckets are walked in
+// occupancy order up to the one of src since the bucket head isn't
+// necessarily the fullest SLAB of bucket
+static inline slab_t *_get_compact_target( slab_list_t *sl, slab_t *src ) {
+	unsigned int src_free = _get_free_slots( src );
+	unsigned int last = _get_partial_bucket( src_free );
+
+	for( unsigned int cyc = 0; cyc <= last; ++cyc )
+		for( slab_t *s = sl->partial_list[ cyc ]; s != NULL; s = s->next )
+			if( ( s != src ) && ( _get_free_slots( s ) < src_free ) )
+				return s;
+
+	return NULL;
+}
+
+// relocate objects from the least occupied SLABs to the most occupied ones
+static unsigned int _compact_slab_list( cache_t *cache,
+	slab_list_t *sl,
+	unsigned int budget
+) {
+	unsigned int moved = 0;
+	for( ; moved < budget; ++moved ) {
+		slab_t *src = _get_emptiest_slab( sl );
+		if( src == NULL )
+			break;
+
+		// it makes sense to move objects only to the SLAB which is fuller
+		// than the source; otherwise we will be playing ping-pong
+		slab_t *dst = _get_compact_target( sl, src );
+		if( dst == NULL )
+			break;
+
+		unsigned int src_free = _get_free_slots( src );
+		unsigned int dst_free = _get_free_slots( dst );
+		// the first allocated slot in source SLAB
+		int slotn = ffs( ( int ) ~( src->map ) ) - 1;
+		void *from = ( ( char* ) src ) + cache->header_sz +
+			( cache->blk_sz * slotn );
+		void *to = _get_block( cache, dst );
+
+		cache->slab_class.move( to, from, cache->slab_class.ctag );
+		if( cache->options & SLAB_REFERABLE )
+			*( _get_counter_ptr( cache, to ) ) =
+				*( _get_counter_ptr( cache, from ) );
+
+		if( cache->slab_class.reinit != NULL )
+			cache->slab_class.reinit( from, cache->slab_class.ctag );
+
+		// handles of the object refer to the old place
+		src->map |= 1u << slotn;
+		_expire_handles( cache, src, 1u << slotn );
+		_refile_slab( sl, dst, dst_free, dst_free - 1 );
+		_refile_slab( sl, src, src_free, src_free + 1 );
+	}
+
+	return moved;
+}
+
+// objects are moved within slab list only since chunk can't change its list
+unsigned int pool_compact( cache_t *cache, unsigned int budget ) {
+	assert( cache != NULL );
+
+	if( cache->slab_class.move == NULL )
+		return 0;
+
+	unsigned int moved = 0;
+	slab_list_t *sl = NULL;
+	for( unsigned int idx = 0;
+		( moved < budget ) &&
+			( ( sl = _get_slab_list_at( cache, idx ) ) != NULL );
+		++idx
+	) {
+		moved += _compact_slab_list( cache, sl, budget - moved );
+		_release_slab_list( cache, sl );
+	}
+
+	return moved;
+}
+
+// visits live slots of SLABs sorted by address; the next SLAB is
+// prefetched while the current one is walked
+static int _visit_slabs( cache_t *cache,
+	slab_t **slabs,
+	size_t n,
+	pool_visitor_t fn,
+	void *arg
+) {
+	for( size_t cyc = 0; cyc < n; ++cyc ) {
+		slab_t *s = slabs[ cyc ];
+		char *base = ( ( char* ) s ) + cache->header_sz;
+
+		if( cyc + 1 < n )
+			__builtin_prefetch( slabs[ cyc + 1 ] );
+
+		for( blockmap_t live = ~( s->map ); live; live &= live - 1 ) {
+			int rc = fn( base + cache->blk_sz * ( ffs( ( int ) live ) - 1 ),
+				arg
+			);
+
+			if( rc )
+				return rc;
+		}
+	}
+
+	return 0;
+}
+
+static int _compare_slabs( const void *a, const void *b ) {
+	uintptr_t sa = ( uintptr_t ) *( ( slab_t* const* ) a );
+	uintptr_t sb = ( uintptr_t ) *( ( slab_t* const* ) b );
+
+	return ( sa > sb ) - ( sa < sb );
+}
+
+// SLABs of the list sorted by address; NULL if there is no memory
+static slab_t **_sort_slabs( slab_list_t *sl, size_t *n ) {
+	*n = _collect_slabs( sl, NULL );
+
+	slab_t **ret = malloc( sizeof( slab_t* ) * ( *n + 1 ) );
+	if( ret == NULL )
+		return NULL;
+
+	_collect_slabs( sl, ret );
+	qsort( ret, *n, sizeof( slab_t* ), _compare_slabs );
+
+	return ret;
+}
+
+int pool_foreach( cache_t *cache, pool_visitor_t fn, void *arg ) {
+	assert( cache != NULL );
+	assert( fn != NULL );
+
+	int rc = 0;
+	slab_list_t *sl = NULL;
+
+	for( unsigned int idx = 0;
+		( rc == 0 ) && ( ( sl = _get_slab_list_at( cache, idx ) ) != NULL );
+		++idx
 	) {
-		if( cache->slab_class->reinit != NULL )
-			cache->slab_class->reinit( obj, cache->slab_class->ctag );
+		size_t n = 0;
+		slab_t **slabs = _sort_slabs( sl, &n );
+
+		if( slabs != NULL )
+			rc = _visit_slabs( cache, slabs, n, fn, arg );
+
+		_release_slab_list( cache, sl );
+		free( slabs );
+	}
+
+	return rc;
+}
+
+int pool_foreach_part( cache_t *cache,
+	pool_visitor_t fn,
+	void *arg,
+	unsigned int part,
+	unsigned int nparts
+) {
+	assert( cache != NULL );
+	assert( fn != NULL );
+	assert( part < nparts );
 
-		// get the sequence number
-		unsigned int pos = *( ( ( unsigned char* ) obj ) + cache->blk_sz - 1 );
-		// rid off terminator bit
-		pos &= ~ SLAB_LIST_TERMINATOR;
+	slab_t **slabs = NULL;
+	size_t n = 0;
+	slab_list_t *sl = NULL;
 
-		// calculating slab header memory address
-		slab_t *cur = ( slab_t* ) (
-			( ( unsigned char* ) obj ) - cache->blk_sz * pos - cache->header_sz
+	// all lists are gathered, so that parts are equal whatever the number
+	// of lists is
+	for( unsigned int idx = 0;
+		( sl = _get_slab_list_at( cache, idx ) ) != NULL;
+		++idx
+	) {
+		size_t more = _collect_slabs( sl, NULL );
+		slab_t **grown = realloc( slabs,
+			sizeof( slab_t* ) * ( n + more + 1 )
 		);
 
-		// was the slab full?
-		if( ( ! cur->map ) && ( cur != cache->head ) ) {
-			// if slab was full and it wasn't the head then
-			// we should elect it as new head to maintain separation
-			// of full SLABs and not ful ones
-			cur->prev->next = cur->next;
+		if( grown != NULL ) {
+			slabs = grown;
+			n += _collect_slabs( sl, slabs + n );
+		}
 
-			if( cur->next != NULL )
-				cur->next->prev = cur->prev;
+		_release_slab_list( cache, sl );
 
-			( cache->head->prev = cur )->prev = NULL;
-			cur->next = cache->head;
-			cache->head = cur;
+		if( grown == NULL ) {
+			free( slabs );
+			return 0;
 		}
+	}
+
+	if( slabs == NULL )
+		return 0;
+
+	qsort( slabs, n, sizeof( slab_t* ), _compare_slabs );
+
+	size_t first = n * part / nparts;
+	size_t last = n * ( part + 1 ) / nparts;
+	int rc = _visit_slabs( cache, slabs + first, last - first, fn, arg );
+
+	free( slabs );
+
+	return rc;
+}
+
+// live objects which are being released by reset are recycled; batched
+// routine gets each run of adjacent objects at once, so the whole chunk is
+// usually done with a single call
+static inline void _reinit_slots( cache_t *cache,
+	slab_t *s,
+	blockmap_t released
+) {
+	char *base = ( ( char* ) s ) + cache->header_sz;
+
+	if( cache->slab_class.reinit_bulk != NULL )
+		while( released ) {
+			unsigned int first = ffs( ( int ) released ) - 1;
+			unsigned int rest = ~( ( unsigned int ) released >> first );
+			unsigned int n = rest ? ( ffs( ( int ) rest ) - 1 ) :
+				( SLOTS_NUM - first );
+
+			cache->slab_class.reinit_bulk( base + cache->blk_sz * first,
+				cache->blk_sz,
+				n,
+				cache->slab_class.ctag
+			);
+
+			if( first + n >= SLOTS_NUM )
+				break;
+
+			released &= ~( ( ( 1u << n ) - 1 ) << first );
+		}
+	else if( cache->slab_class.reinit != NULL )
+		for( ; released; released &= released - 1 )
+			cache->slab_class.reinit(
+				base + cache->blk_sz * ( ffs( ( int ) released ) - 1 ),
+				cache->slab_class.ctag
+			);
+}
+
+// sets new map of SLAB and moves it to the matching list
+static inline void _reset_slab( cache_t *cache,
+	slab_list_t *sl,
+	slab_t *s,
+	blockmap_t map
+) {
+	unsigned int nfree = _get_free_slots( s );
+	blockmap_t released = map & ( ~( s->map ) );
+
+	_reinit_slots( cache, s, released );
+	_expire_handles( cache, s, released );
+	s->map = map;
+	_refile_slab( sl, s, nfree, _get_free_slots( s ) );
+}
+
+static void _reset_slab_list( cache_t *cache, slab_list_t *sl ) {
+	slab_t **chains[ PARTIAL_BUCKETS_NUM + 1 ];
+	chains[ 0 ] = &( sl->full_list );
+	for( unsigned int cyc = 0; cyc < PARTIAL_BUCKETS_NUM; ++cyc )
+		chains[ cyc + 1 ] = &( sl->partial_list[ cyc ] );
+
+	// each SLAB is moved to the free list as soon as it's reset, so
+	// the head of chain is always the next one to process
+	for( unsigned int cyc = 0; cyc < PARTIAL_BUCKETS_NUM + 1; ++cyc )
+		while( *( chains[ cyc ] ) != NULL )
+			_reset_slab( cache, sl, *( chains[ cyc ] ), EMPTY_MAP );
+
+	sl->hot = NULL;
+}
+
+void pool_reset( cache_t *cache ) {
+	assert( cache != NULL );
+
+	slab_list_t *sl = NULL;
+	for( unsigned int idx = 0;
+		( sl = _get_slab_list_at( cache, idx ) ) != NULL;
+		++idx
+	) {
+		_reset_slab_list( cache, sl );
+		_release_slab_list( cache, sl );
+	}
+}
+
+/**
+ * Chunk state recorded by checkpoint.
+ * @see pool_mark_t
+ */
+typedef struct {
+	slab_t *slab; /**< Chunk.*/
+	unsigned int serial; /**< Its serial number.*/
+	blockmap_t map; /**< Its map at the moment of checkpoint.*/
+} mark_entry_t;
+
+/**
+ * Checkpoint of cache state.
+ * Chunks of all slab lists are stored sorted by chunk address.
+ * @see pool_mark
+ */
+struct _pool_mark_t {
+	size_t nslabs; /**< Number of chunks at the moment of checkpoint.*/
+	mark_entry_t *slabs; /**< Chunks and their maps.*/
+};
+
+static int _compare_entries( const void *a, const void *b ) {
+	uintptr_t sa = ( uintptr_t ) ( ( const mark_entry_t* ) a )->slab;
+	uintptr_t sb = ( uintptr_t ) ( ( const mark_entry_t* ) b )->slab;
+
+	return ( sa > sb ) - ( sa < sb );
+}
 
-		// set corresponding bit in map
-		cur->map |= 1u << pos;
+// appends states of list chunks to checkpoint; 0 if there is no memory
+static int _mark_slab_list( pool_mark_t *m, slab_list_t *sl ) {
+	size_t more = _collect_slabs( sl, NULL );
+	slab_t **cur = malloc( sizeof( slab_t* ) * ( more + 1 ) );
+	mark_entry_t *grown = realloc( m->slabs,
+		sizeof( mark_entry_t ) * ( m->nslabs + more + 1 )
+	);
+
+	if( grown != NULL )
+		m->slabs = grown;
+
+	if( ( cur == NULL ) || ( grown == NULL ) ) {
+		free( cur );
+		return 0;
+	}
+
+	_collect_slabs( sl, cur );
+	for( size_t cyc = 0; cyc < more; ++cyc ) {
+		grown[ m->nslabs + cyc ].slab = cur[ cyc ];
+		grown[ m->nslabs + cyc ].serial = cur[ cyc ]->serial;
+		grown[ m->nslabs + cyc ].map = cur[ cyc ]->map;
+	}
+
+	m->nslabs += more;
+	free( cur );
 
+	return 1;
+}
+
+pool_mark_t *pool_mark( cache_t *cache ) {
+	assert( cache != NULL );
+
+	pool_mark_t *m = malloc( sizeof( pool_mark_t ) );
+	if( m == NULL )
+		return NULL;
+
+	m->nslabs = 0;
+	m->slabs = NULL;
+
+	int ok = 1;
+	slab_list_t *sl = NULL;
+	for( unsigned int idx = 0;
+		ok && ( ( sl = _get_slab_list_at( cache, idx ) ) != NULL );
+		++idx
+	) {
+		ok = _mark_slab_list( m, sl );
+		_release_slab_list( cache, sl );
+	}
+
+	if( ! ok ) {
+		free( m->slabs );
+		free( m );
 		return NULL;
 	}
 
-	#if LIBMEMPOOL_MULTITHREADED
-		pthread_mutex_unlock( &( cache->protect ) );
-	#endif
+	qsort( m->slabs, m->nslabs, sizeof( mark_entry_t ), _compare_entries );
 
-	return obj;
+	return m;
+}
+
+static void _rollback_slab_list( cache_t *cache,
+	slab_list_t *sl,
+	pool_mark_t *mark
+) {
+	// lists are changed while SLABs are reset, so they are collected
+	// beforehand
+	size_t n = _collect_slabs( sl, NULL );
+	slab_t **cur = malloc( sizeof( slab_t* ) * ( n + 1 ) );
+	if( cur == NULL )
+		return;
+
+	_collect_slabs( sl, cur );
+
+	for( size_t cyc = 0; cyc < n; ++cyc ) {
+		mark_entry_t key = { .slab = cur[ cyc ] };
+		mark_entry_t *known = bsearch( &key,
+			mark->slabs,
+			mark->nslabs,
+			sizeof( mark_entry_t ),
+			_compare_entries
+		);
+
+		// blocks free at checkpoint are free again; SLAB created after
+		// checkpoint (possibly in place of reaped one) is empty
+		blockmap_t map = EMPTY_MAP;
+		if( ( known != NULL ) && ( known->serial == cur[ cyc ]->serial ) )
+			map = cur[ cyc ]->map | known->map;
+
+		_reset_slab( cache, sl, cur[ cyc ], map );
+	}
+
+	sl->hot = NULL;
+	free( cur );
+}
+
+void pool_release( cache_t *cache, pool_mark_t *mark ) {
+	assert( cache != NULL );
+	assert( mark != NULL );
+
+	slab_list_t *sl = NULL;
+	for( unsigned int idx = 0;
+		( sl = _get_slab_list_at( cache, idx ) ) != NULL;
+		++idx
+	) {
+		_rollback_slab_list( cache, sl, mark );
+		_release_slab_list( cache, sl );
+	}
+
+	free( mark->slabs );
+	free( mark );
+}
+
+int pool_latency_histogram( cache_t *cache,
+	enum pool_slow_path path,
+	unsigned long long buckets[ POOL_HISTOGRAM_BUCKETS ]
+) {
+	assert( cache != NULL );
+	assert( path < POOL_SLOW_PATHS_NUM );
+
+#if LIBMEMPOOL_HISTOGRAMS
+	for( unsigned int cyc = 0; cyc < POOL_HISTOGRAM_BUCKETS; ++cyc )
+		buckets[ cyc ] = __atomic_load_n( &( cache->histograms[ path ][ cyc ] ),
+			__ATOMIC_RELAXED
+		);
+
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+void pool_set_budget( cache_t *cache,
+	size_t max_bytes,
+	pool_pressure_t pressure,
+	void *arg
+) {
+	assert( cache != NULL );
+
+	cache = _get_chunk_owner( cache );
+
+	// budget below one chunk still allows one chunk; 0 means no budget
+	size_t max = max_bytes / _get_slab_size( cache );
+	if( max_bytes && ( max == 0 ) )
+		max = 1;
+
+	cache->pressure = pressure;
+	cache->pressure_arg = arg;
+	__atomic_store_n( &( cache->max_slabs ), max, __ATOMIC_RELAXED );
 }
@@ -11,6 +11,8 @@
 #include <mempool_config.h>
 // we need size_t type
 #include <stdlib.h>
+// and uint32_t for handles
+#include <stdint.h>
 
 #ifdef __cplusplus
 	extern "C" {
@@ -31,9 +33,25 @@
  * reinit will be invoked to prepare existing object for further use. It can be
  * considered as combination of lightweight destructor with lightweight
  * constructor. Class may not have ctor, dtor or reinit. Simple memory
- * allocation and freeing will be performed in this case.
+ * allocation and freeing will be performed in this case. move is optional
+ * relocation routine used by cache compaction. It should transfer object
+ * state from src slot to dst slot (which contains constructed object) and fix
+ * all references to the object held by client. After that src slot is
+ * considered free and will be recycled with reinit as if it had been put back
+ * to the cache. Without move objects will never be relocated. ctor_bulk and
+ * dtor_bulk are optional batched versions of ctor and dtor: they process n
+ * slots placed stride bytes apart starting from first one. If they are given
+ * then they are used instead of ctor and dtor on chunk creation and
+ * destruction, so objects can be initialized in a single loop instead of a
+ * call per slot. reinit_bulk is batched version of reinit used when run of
+ * adjacent objects is recycled at once (pool_reset and pool_release); single
+ * objects are still recycled with reinit, so class should have both. Slot is
+ * wider than object since cache keeps service data at its end, so batched
+ * routines may write only the first blk_sz bytes of each stride-sized
+ * slot.
  * @see cache_t
  * @see pool_create
+ * @see pool_compact
  */
 typedef struct {
 	size_t blk_sz; /**< Resulting block size after adjustments and corrections
@@ -46,6 +64,23 @@ typedef struct {
 												Can be NULL. */
 	void ( *reinit )( void *obj, void *ctag ); /**< Object "recycler".
 												Can be NULL. */
+	void ( *move )( void *dst, void *src, void *ctag ); /**< Object
+												relocator. Can be NULL. */
+	void ( *ctor_bulk )( void *first,
+		size_t stride,
+		unsigned int n,
+		void *ctag
+	); /**< Batched object constructor. Can be NULL. */
+	void ( *dtor_bulk )( void *first,
+		size_t stride,
+		unsigned int n,
+		void *ctag
+	); /**< Batched object destructor. Can be NULL. */
+	void ( *reinit_bulk )( void *first,
+		size_t stride,
+		unsigned int n,
+		void *ctag
+	); /**< Batched object "recycler". Can be NULL. */
 } slab_class_t;
 
 /**
@@ -57,12 +92,219 @@ typedef struct {
  */
 #define SLAB_REFERABLE 1
 
+/**
+ * Whether chunks are carved from huge page arena.
+ * If it's specified then chunks will be placed contiguously in 2 MB-aligned
+ * regions backed by huge pages (explicit ones if they are available and
+ * transparent ones otherwise). If huge pages can't be used or chunk doesn't
+ * fit into region then regular memory backend is used silently.
+ * @see cache_t
+ * @see pool_hugepage_stats
+ */
+#define SLAB_HUGE_PAGES 2
+
+/**
+ * Whether recently released blocks are reused first.
+ * If it's specified then allocation prefers the block released last: its
+ * memory is likely to be in CPU cache yet. Block which is expected to be
+ * handed out next is prefetched. Otherwise the first free block in the
+ * fullest chunk is picked.
+ * @see cache_t
+ */
+#define SLAB_LIFO 4
+
+/**
+ * Whether allocated blocks are zero-filled.
+ * If it's specified then each allocated block is filled with zeroes (its
+ * slab_class_t::blk_sz bytes). Cache tracks which slots are known to be
+ * clean: slots which haven't been handed out since their chunk has been
+ * obtained from fresh (or returned to the kernel) pages aren't cleared again.
+ * Dirty slots are cleared lazily on allocation. Object class can't have ctor,
+ * reinit and their batched versions since they would break zero-fill
+ * guarantee.
+ * @see cache_t
+ */
+#define SLAB_ZERO 8
+
+/**
+ * Whether cache must not share chunks with compatible caches.
+ * Cache classes which merge caches of the same geometry keep cache with this
+ * option apart. It's useful for debugging of memory corruption and for
+ * caches which need their own budget and statistics.
+ * @see cache_t
+ * @see pool_lockable_create
+ */
+#define SLAB_NO_MERGE 16
+
+/**
+ * Whether blocks can be referred with 32-bit handles.
+ * If it's specified then cache keeps table of its chunks, so that block can
+ * be identified with chunk index and slot number packed into 32 bits.
+ * Merged caches don't support handles, so such cache is never merged.
+ * @see pool_handle_t
+ * @see pool_object_alloc_h
+ */
+#define SLAB_HANDLES 32
+
+/**
+ * Whether handles carry generation of the slot.
+ * Implies SLAB_HANDLES. Generation of the slot is incremented each time
+ * block is released (including blocks parked in per-thread magazines or SPSC
+ * ring, blocks moved by pool_compact and blocks released in bulk with
+ * pool_reset/pool_release) and for all slots when chunk is destroyed, so
+ * dereferencing of stale handle yields NULL. Generation takes 8 bits of
+ * handle, which limits cache to 2^19 chunks (2^27 otherwise), and it wraps
+ * around: once the slot has been released 256 times since handle was taken,
+ * stale handle resolves to the current occupant of the slot again. So it's
+ * a debugging aid for use-after-free rather than a guarantee.
+ * @see pool_handle_deref
+ */
+#define SLAB_HANDLE_GEN 64
+
+/**
+ * Compact reference to block.
+ * Handle consists of slot number (lowest POOL_HANDLE_SLOT_BITS bits), chunk
+ * index and, with SLAB_HANDLE_GEN, slot generation (highest
+ * POOL_HANDLE_GEN_BITS bits).
+ * @see SLAB_HANDLES
+ */
+typedef uint32_t pool_handle_t;
+
+/**
+ * Handle which doesn't refer to any block.
+ * Chunk index 0 is never used, so no block has such handle.
+ */
+#define POOL_HANDLE_NULL 0u
+
+/**
+ * Width of slot number in handle.
+ * It matches the number of slots in chunk.
+ */
+#define POOL_HANDLE_SLOT_BITS 5
+
+/**
+ * Width of slot generation in handle.
+ * Generation is compared modulo 2^POOL_HANDLE_GEN_BITS.
+ * @see SLAB_HANDLE_GEN
+ */
+#define POOL_HANDLE_GEN_BITS 8
+
+/**
+ * Chunk table is two-level one: blocks of 2^POOL_HANDLE_BLOCK_SHIFT entries
+ * are allocated on demand and never moved. The first level grows by doubling
+ * and outgrown copies of it are kept until cache is destroyed, so
+ * dereferencing needs no locks.
+ */
+#define POOL_HANDLE_BLOCK_SHIFT 10
+
+/**
+ * Entry of chunk table.
+ * @see cache_t
+ */
+typedef struct {
+	void *slab; /**< Chunk; NULL if index is free.*/
+	unsigned int next_free; /**< Next free index if chunk is NULL.*/
+	unsigned char gen[ 1 << POOL_HANDLE_SLOT_BITS ]; /**< Generations of
+														slots.*/
+} pool_handle_entry_t;
+
+/**
+ * Allocator slow paths which latency is measured.
+ * @see pool_latency_histogram
+ */
+enum pool_slow_path {
+	POOL_SLAB_ALLOC = 0, /**< New chunk creation including construction.*/
+	POOL_SLAB_CTOR, /**< Construction of objects in new chunk.*/
+	POOL_LOCK_WAIT, /**< Waiting for contended cache lock.*/
+	POOL_REAP, /**< Eviction of free chunks.*/
+	POOL_SLOW_PATHS_NUM
+};
+
+/**
+ * Number of buckets in latency histogram.
+ * Bucket i counts latencies in [ 2^i, 2^(i+1) ) nanoseconds; the last bucket
+ * counts all longer ones as well.
+ * @see pool_latency_histogram
+ */
+#define POOL_HISTOGRAM_BUCKETS 32
+
+/**
+ * Types of events recorded into allocation trace.
+ * @see pool_trace_start
+ */
+enum pool_trace_type {
+	POOL_TRACE_ALLOC = 0, /**< pool_object_alloc succeeded.*/
+	POOL_TRACE_GET, /**< pool_object_get.*/
+	POOL_TRACE_PUT, /**< pool_object_put.*/
+	POOL_TRACE_REAP /**< pool_reap.*/
+};
+
+/**
+ * Source of memory for SLAB chunks.
+ * By default, chunks are requested from memory backend one by one. Source may
+ * be replaced with an arena which places chunks in its own memory regions.
+ * @see cache_t
+ */
+typedef struct {
+	void *( *slab_alloc )( void *arena, size_t sz, size_t align ); /**<
+								Allocates chunk; returns NULL on failure.*/
+	void ( *slab_free )( void *arena, void *slab ); /**< Releases chunk.*/
+	void ( *arena_destroy )( void *arena ); /**< Releases arena itself after
+											all chunks are released.
+											Can be NULL.*/
+	int zeroed; /**< Whether chunks are zero-filled when they are handed
+					out.*/
+	int concurrent; /**< Whether routines above may be called by several
+						threads simultaneously. Refiller serves only caches
+						which source is such one.*/
+	void *arena; /**< Arena state; will be passed to routines above.*/
+} slab_source_t;
+
+typedef struct _cache_t cache_t;
+
 typedef struct {
 	slab_list_t *( *get_slab_list )( cache_t* );
+	void ( *release_slab_list )( cache_t*, slab_list_t* ); /**< Called when
+							work with slab list obtained by get_slab_list
+							is done. Can be NULL.*/
 	void ( *pool_destroy )( cache_t* );
 	void ( *pool_evict )( cache_t* );
+	void *( *object_alloc )( cache_t* ); /**< Overrides pool_object_alloc
+											for caches which don't keep
+											chunks in slab_list_t.
+											Can be NULL.*/
+	void *( *object_get )( cache_t*, void* ); /**< Overrides
+											pool_object_get. Can be NULL.*/
+	void *( *object_put )( cache_t*, void* ); /**< Overrides
+											pool_object_put. Can be NULL.*/
+	slab_list_t *( *get_slab_list_at )( cache_t*, unsigned int ); /**<
+							Acquires slab list with given index for caches
+							which have several ones; returns NULL if index is
+							out of range. Released with release_slab_list.
+							Can be NULL (the only list is the one returned
+							by get_slab_list).*/
+	cache_t *( *get_owner )( cache_t* ); /**< Returns cache which chunks
+							are taken from and charged to, if it isn't
+							the cache itself (merged cache, for example).
+							Budget and refiller are applied to that cache.
+							Can be NULL.*/
 } cache_class_t;
 
+/**
+ * Memory pressure handler.
+ * Invoked when cache budget is exhausted and reaping of cache's own free
+ * chunks hasn't helped. Handler may free memory elsewhere (reap other caches,
+ * drop client-side caches holding objects of this cache and so on). It's
+ * invoked without cache locks held.
+ * @param cache cache which allocation has failed on; merged caches share
+ * 			budget of their group
+ * @param arg argument given to pool_set_budget
+ * @return !=0 - something has been freed and allocation should be retried;
+ * 			0 - allocation should fail
+ * @see pool_set_budget
+ */
+typedef int ( *pool_pressure_t )( cache_t *cache, void *arg );
+
 /**
  * Cache structure.
  * Structure contains all common information needed for pointer arithmetic
@@ -73,9 +315,11 @@ typedef struct {
  * @see pool_free
  * @see pool_alloc
  */
-typedef struct {
-	unsigned int options; /**< Allocation options. It has the sole allowed
-							option - SLAB_REFERABLE.*/
+struct _cache_t {
+	unsigned int options; /**< Allocation options. SLAB_REFERABLE,
+							SLAB_HUGE_PAGES, SLAB_LIFO, SLAB_ZERO,
+							SLAB_NO_MERGE, SLAB_HANDLES and SLAB_HANDLE_GEN
+							are allowed.*/
 	size_t align; /**< Requested alignment of data block.*/
 	size_t blk_sz; /**< Resulting block size after adjustments and corrections
 					made in cache constructor.*/
@@ -84,20 +328,63 @@ typedef struct {
 	unsigned int init_sz; /**< Cache initial size. */
 	cache_class_t cache_class; /**< Cache class (type) */
 	slab_class_t slab_class; /**< Object class. */
-} cache_t;
+	slab_source_t slab_source; /**< Where chunks come from. */
+	size_t nslabs; /**< Number of chunks allocated. Updated atomically on
+						chunk creation and destruction only.*/
+	size_t max_slabs; /**< Budget in chunks; 0 - unlimited. */
+	pool_pressure_t pressure; /**< Budget exhaustion handler. Can be NULL.*/
+	void *pressure_arg; /**< Argument for pressure handler. */
+	struct _slab_t *reserve; /**< Free chunks built in advance by refiller.
+								Lock-free stack; taken as a whole.*/
+	unsigned int nreserved; /**< Number of chunks in reserve. Never lower
+								than actual one.*/
+	struct _refiller_t *refiller; /**< Refiller cache is attached to.
+									Can be NULL.*/
+	unsigned int refiller_wakers; /**< Threads which are waking refiller
+										up right now; detaching waits for
+										them.*/
+	pool_handle_entry_t **handles; /**< Chunk table; NULL until the first
+									chunk of SLAB_HANDLES cache.*/
+	unsigned int handles_cap; /**< Number of blocks the first level of
+								chunk table holds.*/
+	unsigned int handles_bits; /**< Width of chunk index in handle.*/
+	unsigned int handles_next; /**< The lowest index never used.*/
+	unsigned int handles_free; /**< Head of free indices chain; 0 - none.*/
+	unsigned int handles_lock; /**< Guards chunk table modifications.*/
+	unsigned int slab_serial; /**< Serial number of the last chunk created.*/
+	unsigned int refs; /**< Number of holders keeping the cache alive: its
+							owner and, for zoned cache, zones of threads
+							which haven't exited yet.*/
+#if LIBMEMPOOL_HISTOGRAMS
+	unsigned long long histograms[ POOL_SLOW_PATHS_NUM ]
+		[ POOL_HISTOGRAM_BUCKETS ]; /**< Slow path latencies. */
+#endif
+};
+
+#if LIBMEMPOOL_TRACE
+	extern void _pool_trace_record( enum pool_trace_type type,
+		cache_t *cache,
+		void *obj,
+		size_t size
+	);
+#endif
+
+extern void _pool_unref( cache_t *cache );
 
 /**
  * Destroys created pool (or cache).
  * Destroys created pool (or cache) with all its chunks. Deallocates memory via
- * backend routine.
+ * backend routine. Zone of thread is freed on thread exit, so zoned cache is
+ * actually destroyed when the last thread which used it is gone.
  * @param cache cache going to be destroyed
  * @see pool_create
  * @see pool_reap
  */
 static inline void pool_free( cache_t *cache ) {
 	assert( cache != NULL );
-	cache->cache_class.pool_destroy( cache );
-	free( cache );
+	// reserve is released on detach
+	assert( cache->refiller == NULL );
+	_pool_unref( cache );
 }
 
 /**
@@ -109,9 +396,179 @@ static inline void pool_free( cache_t *cache ) {
  * @see pool_free
  */
 static inline void pool_reap( cache_t *cache ) {
+#if LIBMEMPOOL_TRACE
+	_pool_trace_record( POOL_TRACE_REAP, cache, NULL, 0 );
+#endif
 	cache->cache_class.pool_evict( cache )
 }
 
+/**
+ * Relocates objects from sparsely occupied chunks to fuller ones.
+ * Takes allocated objects from the least occupied chunks and moves them to
+ * the most occupied ones with slab_class_t::move routine. Each relocation is
+ * reported to client through the same routine, so that it can fix its
+ * references. Chunks drained completely end up in the list of free chunks
+ * and can be returned to memory backend with pool_reap afterwards. At most
+ * budget objects are moved per call, so compaction can be done
+ * incrementally. Nothing is done if class has no move routine. Note that
+ * move is invoked while cache is locked (if cache is thread-safe), so it
+ * mustn't call other routines on the same cache. For zoned cache only zone of
+ * calling thread is compacted; stripes of striped cache are compacted one by
+ * one (objects aren't moved between stripes).
+ * @param cache cache to be compacted
+ * @param budget maximum number of objects to move
+ * @return number of objects moved
+ * @see slab_class_t
+ * @see pool_reap
+ */
+extern unsigned int pool_compact( cache_t *cache, unsigned int budget );
+
+/**
+ * Object visitor.
+ * @param obj allocated object
+ * @param arg argument given to pool_foreach
+ * @return 0 - continue iteration; !=0 - stop it
+ * @see pool_foreach
+ */
+typedef int ( *pool_visitor_t )( void *obj, void *arg );
+
+/**
+ * Visits all allocated objects of cache.
+ * Only chunks which have allocated blocks are walked; free slots are skipped
+ * with chunk maps, objects of chunk are visited in address order and chunks
+ * are visited in address order too (within each slab list). Locking depends
+ * on cache class. Simple cache: nothing is locked, cache shouldn't be used
+ * by other threads. Lockable cache: cache mutex is held during the whole
+ * iteration (for merged cache - mutex of the group, and objects of the whole
+ * group are visited). Zoned cache: only zone of calling thread is visited.
+ * Striped cache: all stripes are visited, each one with its mutex held.
+ * SPSC cache: should be called by allocating thread; objects which are on
+ * their way back are returned first. Fixed cache: as simple one. Shared cache
+ * isn't supported. Since locks may be held, visitor mustn't call other
+ * routines on the same cache.
+ * @param cache cache
+ * @param fn visitor
+ * @param arg argument for visitor
+ * @return 0 - all objects have been visited; otherwise - value returned by
+ * 			visitor which has stopped iteration
+ * @see pool_foreach_part
+ */
+extern int pool_foreach( cache_t *cache, pool_visitor_t fn, void *arg );
+
+/**
+ * Visits part of allocated objects of cache.
+ * Chunks of all slab lists of cache are sorted by address and split into
+ * nparts ranges of equal size; range with index part is visited. So nparts
+ * workers can sweep cache in parallel, each one calling the routine with its
+ * own part. Chunks are collected with cache locks held, but objects are
+ * visited without locks, so cache must not be modified (objects mustn't be
+ * allocated or released) until all workers are done; objects themselves can
+ * be modified. Class-specific notes of pool_foreach apply.
+ * @param cache cache
+ * @param fn visitor
+ * @param arg argument for visitor
+ * @param part index of part to visit
+ * @param nparts number of parts
+ * @return 0 - all objects of part have been visited; otherwise - value
+ * 			returned by visitor which has stopped iteration
+ * @see pool_foreach
+ */
+extern int pool_foreach_part( cache_t *cache,
+	pool_visitor_t fn,
+	void *arg,
+	unsigned int part,
+	unsigned int nparts
+);
+
+/**
+ * Releases all objects of cache at once.
+ * Marks every chunk as empty and moves it to the list of free chunks. Work
+ * is done per chunk rather than per object; only if class has reinit_bulk or
+ * reinit live objects are recycled: reinit_bulk is invoked once per run of
+ * adjacent live objects, reinit - for each one. Reference counters are
+ * ignored. Chunks stay
+ * in cache and can be returned to memory backend with pool_reap. Useful for
+ * request-scoped (scratch) caches. For zoned cache only zone of calling
+ * thread is reset, for striped cache - all stripes one by one; merged
+ * lockable caches reset the whole group (use SLAB_NO_MERGE for scratch
+ * caches). Shared cache isn't supported.
+ * @param cache cache to be reset
+ * @see pool_mark
+ */
+extern void pool_reset( cache_t *cache );
+
+/**
+ * Checkpoint of cache state.
+ * @see pool_mark
+ */
+typedef struct _pool_mark_t pool_mark_t;
+
+/**
+ * Takes checkpoint of cache state.
+ * Checkpoint records which blocks are allocated at the moment (one map per
+ * chunk). pool_release frees all blocks allocated after checkpoint at once,
+ * so cache behaves as stack-like arena. Checkpoints can be nested; they
+ * should be released in reverse order. Blocks allocated before checkpoint
+ * mustn't be put back until checkpoint is released. Chunks are identified by
+ * address and serial number, so free chunks may be reaped meanwhile (by
+ * pool_reap or budget enforcement) even if arena reuses their addresses.
+ * Same restrictions as for pool_reset apply.
+ * @param cache cache
+ * @return !=NULL - checkpoint; NULL - something went wrong
+ * @see pool_release
+ * @see pool_reset
+ */
+extern pool_mark_t *pool_mark( cache_t *cache );
+
+/**
+ * Rolls cache back to checkpoint.
+ * Blocks allocated after checkpoint are released (they are recycled as
+ * pool_reset does it), chunks created after checkpoint are reset completely.
+ * Checkpoint is destroyed.
+ * @param cache cache checkpoint has been taken for
+ * @param mark checkpoint
+ * @see pool_mark
+ */
+extern void pool_release( cache_t *cache, pool_mark_t *mark );
+
+/**
+ * Limits memory consumed by cache.
+ * Cache won't allocate chunks beyond max_bytes (rounded down to whole
+ * chunks, but at least one chunk is allowed). When budget is exhausted,
+ * allocation evicts free chunks of the cache first (as pool_reap does), then
+ * calls pressure handler if any and retries once if handler reports success;
+ * otherwise NULL is returned.
+ * Accounting is done on chunk creation and destruction only, so allocation
+ * fast path isn't affected. Budget can be changed at any time; chunks already
+ * allocated over new budget aren't released forcibly. Budget of merged
+ * lockable cache is the budget of its whole group; the one set last wins.
+ * @param cache cache to be limited
+ * @param max_bytes budget in bytes; 0 - unlimited
+ * @param pressure budget exhaustion handler; can be NULL
+ * @param arg argument for the handler
+ * @see pool_pressure_t
+ * @see pool_reap
+ */
+extern void pool_set_budget( cache_t *cache,
+	size_t max_bytes,
+	pool_pressure_t pressure,
+	void *arg
+);
+
+/**
+ * Fetches latency histogram of allocator slow path.
+ * Histograms are collected only if library is built with HISTOGRAMS option.
+ * @param cache cache which histogram is requested
+ * @param path slow path
+ * @param buckets where POOL_HISTOGRAM_BUCKETS counters will be stored
+ * @return 0 - success; -1 - histograms aren't collected
+ * @see pool_slow_path
+ */
+extern int pool_latency_histogram( cache_t *cache,
+	enum pool_slow_path path,
+	unsigned long long buckets[ POOL_HISTOGRAM_BUCKETS ]
+);
+
 /**
  * Allocates block from pool (cache).
  * Allocates block marked as unallocated from one of the chunks of the cache.
@@ -125,6 +582,23 @@ static inline void pool_reap( cache_t *cache ) {
  */
 extern void *pool_object_alloc( cache_t *cache );
 
+/**
+ * Allocates block close to existing one.
+ * Allocates block in the same chunk hint belongs to if the chunk has free
+ * blocks. Otherwise the closest by address chunk among the fullest chunks of
+ * each occupancy class is picked. Behaves as pool_object_alloc if there are no
+ * partially filled chunks or hint is NULL. Used to place linked objects
+ * (children of tree node, next node of list) in the same chunk, so that
+ * traversal touches fewer cache lines and pages. Caches which don't keep
+ * chunks in slab_list_t (striped, shared) ignore hint. For zoned cache hint
+ * should be allocated by the calling thread.
+ * @param cache cache which block will be allocated from
+ * @param hint block allocated from the same cache or NULL
+ * @return !=NULL - allocated block; ==NULL - something went wrong
+ * @see pool_object_alloc
+ */
+extern void *pool_object_alloc_near( cache_t *cache, void *hint );
+
 /**
  * Increments block reference counter.
  * If it's requested to be reference-aware then reference counter of the block
@@ -148,6 +622,65 @@ extern void *pool_object_get( cache_t *cache, void *obj );
  */
 extern void *pool_object_put( cache_t *cache, void *obj );
 
+/**
+ * Allocates block and returns its handle.
+ * @param cache cache created with SLAB_HANDLES option
+ * @return !=POOL_HANDLE_NULL - handle of allocated block;
+ * 			==POOL_HANDLE_NULL - something went wrong
+ * @see pool_handle_deref
+ * @see pool_object_put_h
+ */
+extern pool_handle_t pool_object_alloc_h( cache_t *cache );
+
+/**
+ * Fetches handle of allocated block.
+ * @param cache cache created with SLAB_HANDLES option
+ * @param obj allocated block
+ * @return handle of the block
+ * @see pool_handle_deref
+ */
+extern pool_handle_t pool_object_handle( cache_t *cache, void *obj );
+
+/**
+ * Converts handle to block address.
+ * It's just a couple of table lookups and multiplication. Without
+ * SLAB_HANDLE_GEN handle must refer to allocated block.
+ * @param cache cache created with SLAB_HANDLES option
+ * @param h handle
+ * @return block address; NULL if generation of handle doesn't match slot
+ * 			one (block has been released since)
+ * @see pool_object_alloc_h
+ */
+static inline void *pool_handle_deref( cache_t *cache, pool_handle_t h ) {
+	unsigned int idx = ( h >> POOL_HANDLE_SLOT_BITS ) &
+		( ( 1u << cache->handles_bits ) - 1 );
+	unsigned int slot = h & ( ( 1u << POOL_HANDLE_SLOT_BITS ) - 1 );
+	pool_handle_entry_t **table =
+		__atomic_load_n( &( cache->handles ), __ATOMIC_ACQUIRE );
+	pool_handle_entry_t *e = &(
+		table[ idx >> POOL_HANDLE_BLOCK_SHIFT ]
+			[ idx & ( ( 1u << POOL_HANDLE_BLOCK_SHIFT ) - 1 ) ]
+	);
+
+	if( ( cache->options & SLAB_HANDLE_GEN ) &&
+		( e->gen[ slot ] != ( h >> ( 32 - POOL_HANDLE_GEN_BITS ) ) )
+	)
+		return NULL;
+
+	return ( ( char* ) e->slab ) + cache->header_sz + cache->blk_sz * slot;
+}
+
+/**
+ * Decrements reference counter/frees the block referred with handle.
+ * Works as pool_object_put does.
+ * @param cache cache created with SLAB_HANDLES option
+ * @param h handle
+ * @return 0 - block was returned back to the cache; 1 - reference counter
+ * 			was decreased; -1 - handle is stale
+ * @see pool_object_put
+ */
+extern int pool_object_put_h( cache_t *cache, pool_handle_t h );
+
 #ifdef __cplusplus
 	}
 #endif
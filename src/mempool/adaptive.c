@@ -0,0 +1,469 @@
+#include <mempool/adaptive.h>
+#include <mempool/common.h>
+
+#include <mempool.h>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MAGAZINE_SIZE 32
+
+// contention is evaluated each ADAPT_EPOCH lock acquisitions
+#define ADAPT_EPOCH 1024
+
+// promotion: more than 1/PROMOTE_RATIO of acquisitions are contended or
+// waiting takes more than PROMOTE_WAIT_NS per epoch, so PROMOTE_EPOCHS
+// epochs in a row and not earlier than PROMOTE_HOLD_NS after demotion
+#define PROMOTE_RATIO 8
+#define PROMOTE_WAIT_NS 1000000ull
+#define PROMOTE_EPOCHS 2
+#define PROMOTE_HOLD_NS 1000000000ull
+
+// demotion: fewer than DEMOTE_BATCHES acquisitions (magazine refills and
+// flushes) within DEMOTE_IDLE_NS in per-thread mode; contention isn't
+// a criterion there since magazines hide it
+#define DEMOTE_BATCHES 16
+#define DEMOTE_IDLE_NS 100000000ull
+
+struct _adaptive_cache_t;
+
+/**
+ * Per-thread magazine.
+ * Objects in magazine are allocated from cache point of view; they are
+ * recycled already and can be handed out by owner thread without locking.
+ * Magazine is touched by its thread and by demotion which drains magazines
+ * of all threads, so either side claims it first.
+ * @see adaptive_cache_t
+ */
+typedef struct _magazine_t {
+	struct _magazine_t *next; /**< Next magazine of cache.*/
+	struct _magazine_t *prev; /**< Previous magazine of cache.*/
+	struct _adaptive_cache_t *cache; /**< Cache magazine belongs to.*/
+	unsigned int generation; /**< Promotion magazine has been filled in.*/
+	unsigned int busy; /**< Whether magazine is claimed.*/
+	unsigned int n; /**< Number of objects.*/
+	unsigned int nclean; /**< Number of objects at the bottom of magazine
+							known to be zero-filled.*/
+	void *objs[ MAGAZINE_SIZE ]; /**< Objects.*/
+} magazine_t;
+
+/**
+ * Adaptive cache.
+ * Odd generation means per-thread mode; each mode switch increments it.
+ * Contention statistics are updated with mutex held.
+ * @see pool_adaptive_create
+ */
+typedef struct _adaptive_cache_t {
+	cache_t abstract_cache; /**< Cache header.*/
+	slab_list_t slab_list; /**< Slab list.*/
+	pthread_mutex_t protect; /**< Cache mutex.*/
+	pthread_key_t magazine_key; /**< Key of thread's magazine.*/
+	magazine_t *magazines; /**< All magazines; guarded by mutex.*/
+	unsigned int generation; /**< Current mode.*/
+	int can_promote; /**< Whether per-thread mode is allowed.*/
+	unsigned int nacquired; /**< Acquisitions in current epoch.*/
+	unsigned int ncontended; /**< Contended ones among them.*/
+	uint64_t waited_ns; /**< Time spent waiting in current epoch.*/
+	unsigned int nhot; /**< Contended epochs in a row.*/
+	uint64_t epoch_ns; /**< Start of current epoch in per-thread mode.*/
+	uint64_t demoted_ns; /**< Time of the last demotion; 0 - never.*/
+} adaptive_cache_t;
+
+static inline int _claim_magazine( magazine_t *m ) {
+	unsigned int idle = 0;
+	return __atomic_compare_exchange_n( &( m->busy ),
+		&idle,
+		1,
+		0,
+		__ATOMIC_SEQ_CST,
+		__ATOMIC_RELAXED
+	);
+}
+
+static inline void _unclaim_magazine( magazine_t *m ) {
+	__atomic_store_n( &( m->busy ), 0, __ATOMIC_SEQ_CST );
+}
+
+// mutex is held
+static void _flush_magazine( adaptive_cache_t *c,
+	magazine_t *m,
+	unsigned int keep
+) {
+	while( m->n > keep )
+		_release_block( &( c->abstract_cache ),
+			&( c->slab_list ),
+			m->objs[ --( m->n ) ]
+		);
+
+	if( m->nclean > m->n )
+		m->nclean = m->n;
+}
+
+// mutex is held; magazines which are in use right now are skipped, their
+// threads drain them on their own
+static void _drain_magazines( adaptive_cache_t *c, unsigned int gen ) {
+	for( magazine_t *m = c->magazines; m != NULL; m = m->next )
+		if( _claim_magazine( m ) ) {
+			_flush_magazine( c, m, 0 );
+			m->generation = gen;
+			_unclaim_magazine( m );
+		}
+}
+
+// mutex is held; in per-thread mode the mutex is taken by batch operations
+// and pool_reap only, so reading clock each time is cheap, and pool_reap
+// lets cold cache be demoted even if its threads don't touch it anymore
+static void _adapt( adaptive_cache_t *c ) {
+	unsigned int gen = c->generation;
+
+	++( c->nacquired );
+
+	if( gen & 1 ) {
+		uint64_t now = _get_time_ns();
+		if( now - c->epoch_ns < DEMOTE_IDLE_NS )
+			return;
+
+		if( c->nacquired < DEMOTE_BATCHES ) {
+			// idle threads would keep their magazines forever otherwise
+			__atomic_store_n( &( c->generation ), gen + 1, __ATOMIC_SEQ_CST );
+			_drain_magazines( c, gen + 1 );
+			c->demoted_ns = now;
+			POOL_PROBE1( adaptive__demote, c );
+		}
+
+		c->epoch_ns = now;
+		c->nacquired = c->ncontended = 0;
+		c->waited_ns = 0;
+		return;
+	}
+
+	if( c->nacquired < ADAPT_EPOCH )
+		return;
+
+	if( ( c->ncontended * PROMOTE_RATIO > c->nacquired ) ||
+		( c->waited_ns > PROMOTE_WAIT_NS )
+	)
+		++( c->nhot );
+	else
+		c->nhot = 0;
+
+	if( c->can_promote && ( c->nhot >= PROMOTE_EPOCHS ) ) {
+		uint64_t now = _get_time_ns();
+
+		if( ( c->demoted_ns == 0 ) ||
+			( now - c->demoted_ns >= PROMOTE_HOLD_NS )
+		) {
+			__atomic_store_n( &( c->generation ), gen + 1, __ATOMIC_RELAXED );
+			c->nhot = 0;
+			c->epoch_ns = now;
+			POOL_PROBE1( adaptive__promote, c );
+		}
+	}
+
+	c->nacquired = c->ncontended = 0;
+	c->waited_ns = 0;
+}
+
+static slab_list_t *_adaptive_lock( adaptive_cache_t *c ) {
+	uint64_t waited = 0;
+
+	if( _lock_mutex( &( c->protect ), &( c->abstract_cache ), &waited ) )
+		return NULL;
+
+	if( waited ) {
+		++( c->ncontended );
+		c->waited_ns += waited;
+	}
+
+	_adapt( c );
+
+	return &( c->slab_list );
+}
+
+static inline void _adaptive_unlock( adaptive_cache_t *c ) {
+	pthread_mutex_unlock( &( c->protect ) );
+}
+
+static void _free_magazine( void *arg ) {
+	magazine_t *m = arg;
+	adaptive_cache_t *c = m->cache;
+
+	if( _adaptive_lock( c ) != NULL ) {
+		_flush_magazine( c, m, 0 );
+
+		if( m->prev != NULL )
+			m->prev->next = m->next;
+		else
+			c->magazines = m->next;
+
+		if( m->next != NULL )
+			m->next->prev = m->prev;
+
+		_adaptive_unlock( c );
+	}
+
+	free( m );
+}
+
+// claimed magazine of calling thread if cache is in per-thread mode, NULL
+// otherwise; magazine is flushed if it has been filled in previous promotion
+// or cache has been demoted since
+static magazine_t *_get_magazine( adaptive_cache_t *c, unsigned int gen ) {
+	magazine_t *m = pthread_getspecific( c->magazine_key );
+
+	if( m == NULL ) {
+		if( !( gen & 1 ) )
+			return NULL;
+
+		if( ( m = malloc( sizeof( magazine_t ) ) ) == NULL )
+			return NULL;
+
+		m->cache = c;
+		m->generation = gen;
+		m->busy = 0;
+		m->n = m->nclean = 0;
+		m->prev = NULL;
+
+		if( _adaptive_lock( c ) == NULL ) {
+			free( m );
+			return NULL;
+		}
+
+		if( ( m->next = c->magazines ) != NULL )
+			c->magazines->prev = m;
+
+		c->magazines = m;
+		_adaptive_unlock( c );
+
+		pthread_setspecific( c->magazine_key, m );
+	}
+
+	// it's being drained by demotion
+	if( !_claim_magazine( m ) )
+		return NULL;
+
+	if( m->generation != gen ) {
+		if( m->n && ( _adaptive_lock( c ) != NULL ) ) {
+			_flush_magazine( c, m, 0 );
+			_adaptive_unlock( c );
+		}
+
+		m->generation = gen;
+	}
+
+	if( !( gen & 1 ) ) {
+		_unclaim_magazine( m );
+		return NULL;
+	}
+
+	return m;
+}
+
+// demotion might have happened while magazine was claimed and skipped it,
+// so it's drained here then
+static void _put_magazine( adaptive_cache_t *c,
+	magazine_t *m,
+	unsigned int gen
+) {
+	_unclaim_magazine( m );
+
+	if( __atomic_load_n( &( c->generation ), __ATOMIC_SEQ_CST ) == gen )
+		return;
+
+	// nobody else claims magazine while mutex is held
+	if( _adaptive_lock( c ) != NULL ) {
+		_claim_magazine( m );
+		_flush_magazine( c, m, 0 );
+		m->generation = c->generation;
+		_unclaim_magazine( m );
+		_adaptive_unlock( c );
+	}
+}
+
+static void *_pop_object( adaptive_cache_t *c, magazine_t *m ) {
+	if( m->n == 0 ) {
+		// half of magazine is filled at once
+		slab_list_t *sl = _adaptive_lock( c );
+		if( sl == NULL )
+			return NULL;
+
+		void *obj = NULL;
+		while( ( m->n < MAGAZINE_SIZE / 2 ) &&
+			( ( obj = _alloc_block( &( c->abstract_cache ), sl ) ) != NULL )
+		)
+			m->objs[ ( m->n )++ ] = obj;
+
+		_adaptive_unlock( c );
+
+		// _alloc_block has cleared them already
+		m->nclean = m->n;
+
+		if( m->n == 0 )
+			return NULL;
+	}
+
+	void *ret = m->objs[ --( m->n ) ];
+
+	if( m->n < m->nclean )
+		m->nclean = m->n;
+	else if( c->abstract_cache.options & SLAB_ZERO )
+		// object has been recycled through magazine
+		memset( ret, 0, c->abstract_cache.slab_class.blk_sz );
+
+	return ret;
+}
+
+// object is left to the caller if magazine is full and can't be flushed
+static int _push_object( adaptive_cache_t *c, magazine_t *m, void *obj ) {
+	cache_t *cache = &( c->abstract_cache );
+
+	if( m->n == MAGAZINE_SIZE ) {
+		// half of magazine is flushed at once
+		if( _adaptive_lock( c ) == NULL )
+			return 0;
+
+		_flush_magazine( c, m, MAGAZINE_SIZE / 2 );
+		_adaptive_unlock( c );
+	}
+
+	if( cache->slab_class.reinit != NULL )
+		cache->slab_class.reinit( obj, cache->slab_class.ctag );
+
+	_expire_handle( cache, obj );
+	m->objs[ ( m->n )++ ] = obj;
+
+	return 1;
+}
+
+static void *_adaptive_object_alloc( cache_t *cache ) {
+	adaptive_cache_t *c = ( adaptive_cache_t* ) cache;
+	unsigned int gen = __atomic_load_n( &( c->generation ), __ATOMIC_RELAXED );
+	magazine_t *m = _get_magazine( c, gen );
+
+	if( m != NULL ) {
+		void *ret = _pop_object( c, m );
+		_put_magazine( c, m, gen );
+
+		return ret;
+	}
+
+	slab_list_t *sl = _adaptive_lock( c );
+	if( sl == NULL )
+		return NULL;
+
+	void *ret = _alloc_block( cache, sl );
+	_adaptive_unlock( c );
+
+	return ret;
+}
+
+static void *_adaptive_object_get( cache_t *cache, void *obj ) {
+	adaptive_cache_t *c = ( adaptive_cache_t* ) cache;
+
+	// referable caches are never promoted
+	if( cache->options & SLAB_REFERABLE ) {
+		if( _adaptive_lock( c ) == NULL )
+			return NULL;
+
+		_inc_refcount( cache, obj );
+		_adaptive_unlock( c );
+	}
+
+	return obj;
+}
+
+static void *_adaptive_object_put( cache_t *cache, void *obj ) {
+	adaptive_cache_t *c = ( adaptive_cache_t* ) cache;
+	unsigned int gen = __atomic_load_n( &( c->generation ), __ATOMIC_RELAXED );
+	magazine_t *m = _get_magazine( c, gen );
+
+	if( m != NULL ) {
+		int pushed = _push_object( c, m, obj );
+		_put_magazine( c, m, gen );
+
+		if( pushed )
+			return NULL;
+	}
+
+	slab_list_t *sl = _adaptive_lock( c );
+	if( sl == NULL )
+		return NULL;
+
+	obj = _put_block( cache, sl, obj );
+	_adaptive_unlock( c );
+
+	return obj;
+}
+
+cache_t *pool_adaptive_create( unsigned int options,
+	slab_class_t *slab_class,
+	unsigned int inum
+) {
+	adaptive_cache_t *c = _bzero( sizeof( adaptive_cache_t ) );
+	if( c == NULL )
+		return NULL;
+
+	pthread_mutex_init( &( c->protect ), NULL );
+	pthread_key_create( &( c->magazine_key ), _free_magazine );
+	_pool_init( &( c->abstract_cache ),
+		slab_class,
+		&_G_adaptive_cache,
+		options,
+		inum
+	);
+	_prepopulate_list( &( c->abstract_cache ),
+		&( c->slab_list.free_list ),
+		NULL
+	);
+
+	c->can_promote = !( options & SLAB_REFERABLE ) &&
+		( slab_class->move == NULL );
+
+	return &( c->abstract_cache );
+}
+
+// used by generic routines; magazines aren't touched
+static slab_list_t *_get_adaptive_slab_list( cache_t *cache ) {
+	return _adaptive_lock( ( adaptive_cache_t* ) cache );
+}
+
+static void _release_adaptive_slab_list( cache_t *cache, slab_list_t *sl ) {
+	_adaptive_unlock( ( adaptive_cache_t* ) cache );
+}
+
+static void _pool_adaptive_evict( cache_t *cache ) {
+	slab_list_t *sl = _get_adaptive_slab_list( cache );
+	if( sl == NULL )
+		return;
+
+	_evict_slab_list( cache, sl );
+	_release_adaptive_slab_list( cache, sl );
+}
+
+// magazines of threads which are still alive are released here; key is
+// deleted first, so their destructors won't be invoked
+static void _pool_adaptive_destroy( cache_t *cache ) {
+	adaptive_cache_t *c = ( adaptive_cache_t* ) cache;
+
+	pthread_key_delete( c->magazine_key );
+
+	magazine_t *next = NULL;
+	for( magazine_t *m = c->magazines; m != NULL; m = next ) {
+		next = m->next;
+		free( m );
+	}
+
+	_free_slab_list( cache, &( c->slab_list ) );
+	pthread_mutex_destroy( &( c->protect ) );
+}
+
+static cache_class_t _G_adaptive_cache = {
+	.get_slab_list = _get_adaptive_slab_list,
+	.release_slab_list = _release_adaptive_slab_list,
+	.pool_destroy = _pool_adaptive_destroy,
+	.pool_evict = _pool_adaptive_evict,
+	.object_alloc = _adaptive_object_alloc,
+	.object_get = _adaptive_object_get,
+	.object_put = _adaptive_object_put
+};
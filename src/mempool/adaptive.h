@@ -0,0 +1,38 @@
+#ifndef LIBMEMPOOL_ADAPTIVE_H
+#define LIBMEMPOOL_ADAPTIVE_H
+
+#include <mempool.h>
+
+/**
+ * Creates adaptive cache.
+ * Cache starts as lockable one: single slab list protected with mutex. It
+ * measures contention of the mutex (share of failed trylock attempts and time
+ * spent waiting) and, once it stays above threshold for a couple of epochs,
+ * promotes itself to per-thread mode: each thread allocates from and releases
+ * to its own magazine of objects, and the mutex is taken only to refill or
+ * flush half of magazine at once. When those batch operations become rare
+ * (they are counted over wall-clock intervals which are checked by batch
+ * operations and pool_reap, so idle cache is demoted by reaping), cache is
+ * demoted back and magazines of all threads are drained (the one which is in
+ * use at the moment is drained by its thread when the operation is over).
+ * Demoted cache isn't promoted again for a while, so it doesn't flip between
+ * modes. So cold caches don't keep objects in per-thread magazines and hot
+ * ones don't serialize on the mutex. Caches
+ * with SLAB_REFERABLE option or with move routine are never promoted since
+ * reference counters and relocation need the mutex. Objects cached in
+ * magazines are considered allocated by pool_foreach; pool_reset and
+ * checkpoints mustn't be used while cache is promoted.
+ * @param options cache options
+ * @param slab_class SLAB object class
+ * @param inum number of blocks will be reserved for immediate use
+ * @return !=NULL - it will be cache object; NULL - something went wrong
+ * @see pool_free
+ * @see cache_t
+ * @see slab_class_t
+ */
+extern cache_t *pool_adaptive_create( unsigned int options,
+	slab_class_t *slab_class,
+	unsigned int inum
+);
+
+#endif
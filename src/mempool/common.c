@@ -9,38 +9,39 @@
 #include <assert.h>
 #include <limits.h>
 
-#define SLOTS_NUM ( sizeof( unsigned int ) * 8 )
-
-#define SLAB_ALIGNMENT ( ( sizeof( void* ) > alignof( slab_t ) ) ? \
-	sizeof( void* ) : \
-	alignof( slab_t ) \
-)
-
-#define EMPTY_MAP ( ~ ( 0u ) )
-
-#define SLAB_LIST_TERMINATOR 0x80
-
-void _purge_slab_chain( slab_t *sc,
-	void ( *dtor )( void *obj, void *ctag ),
-	void *ctag
-) {
+void _purge_slab_chain( cache_t *cache, slab_t *sc ) {
 	slab_t *next = NULL;
 	while( sc != NULL ) {
 		next = sc->next;
-		_free_slab( sc, dtor, ctag );
+		_free_slab( cache, sc );
 		sc = next;
 	}
 }
 
-void _free_slab_list( slab_list_t *sl,
-	void ( *dtor )( void *obj, void *ctag ),
-	void *ctag
-) {
-	_purge_slab_chain( sl->free_list, c->slab_class.dtor, c->slab_class.ctag );
-	_purge_slab_chain( sl->partial_list,
-		c->slab_class.dtor,
-		c->slab_class.ctag
-	);
-	_purge_slab_chain( sl->full_list, c->slab_class.dtor, c->slab_class.ctag );
-	memset( sl, 0, sizeof( sl ) );
+// stores all chunks of the list to out (if it isn't NULL) and returns their
+// number
+size_t _collect_slabs( slab_list_t *sl, slab_t **out ) {
+	slab_t *chains[ PARTIAL_BUCKETS_NUM + 2 ];
+	size_t n = 0;
+
+	chains[ 0 ] = sl->free_list;
+	chains[ 1 ] = sl->full_list;
+	for( unsigned int cyc = 0; cyc < PARTIAL_BUCKETS_NUM; ++cyc )
+		chains[ cyc + 2 ] = sl->partial_list[ cyc ];
+
+	for( unsigned int cyc = 0; cyc < PARTIAL_BUCKETS_NUM + 2; ++cyc )
+		for( slab_t *s = chains[ cyc ]; s != NULL; s = s->next, ++n )
+			if( out != NULL )
+				out[ n ] = s;
+
+	return n;
+}
+
+void _free_slab_list( cache_t *cache, slab_list_t *sl ) {
+	_purge_slab_chain( cache, sl->free_list );
+	for( unsigned int cyc = 0; cyc < PARTIAL_BUCKETS_NUM; ++cyc )
+		_purge_slab_chain( cache, sl->partial_list[ cyc ] );
+
+	_purge_slab_chain( cache, sl->full_list );
+	memset( sl, 0, sizeof( slab_list_t ) );
 }
@@ -1,6 +1,14 @@
 #ifndef LIBMEMPOOL_COMMON
 #define LIBMEMPOOL_COMMON
 
+#include <mempool/probes.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdint.h>
+
 #if LIBMEMPOOL_LOCKLESS
 	#include <atomic_ops.h>
 #endif
@@ -40,27 +48,71 @@ typedef struct _slab_t {
 	struct _slab_t *next; /**< Pointer to the next chunk in list.*/
 	struct _slab_t *prev; /**< Pointer to the previous chunk in list.*/
 	blockmap_t map; /**< Bitmap of free and occupied blocks.*/
+	blockmap_t zmap; /**< Bitmap of blocks known to be zero-filled. Used by
+						SLAB_ZERO caches only.*/
+	unsigned int owner; /**< Index of slab list (stripe) the chunk belongs to
+							if cache has several of them.*/
+	unsigned char hot; /**< Slot released last.*/
+	unsigned int index; /**< Index in chunk table of the cache if it has
+							SLAB_HANDLES option.*/
+	unsigned int serial; /**< Serial number of chunk in cache; tells chunk
+							from the one which has been placed at the same
+							address before.*/
 } slab_t;
 
 /**
- * Structure represents double linked linear list.
- * Structure contains pointers to the head and the tail of chunks list. This 
- * split allows performing alloc/free operations in constant time.
- * Each time there is no more place in current head chunk (chunk is saturated),
- * library checks the next chunk for the availability of unallocated blocks.
- * If it's saturated as well then new chunk will be created and inserted at
- * the head of the list. If there are some free blocks, next chunk becomes new
- * head. In the meantime, the former head becomes new tail. Hence, you will
- * have partially filled/empty chunks placed firstly and fully saturated chunks
- * placed secondly. If block is released in the one of chunks then it becomes
- * new head as well.
+ * Number of slots in SLAB chunk.
+ * It's equal to bit length of blockmap_t.
+ * @see blockmap_t
+ */
+#define SLOTS_NUM ( sizeof( unsigned int ) * 8 )
+
+#define SLAB_ALIGNMENT ( ( sizeof( void* ) > alignof( slab_t ) ) ? \
+	sizeof( void* ) : \
+	alignof( slab_t ) \
+)
+
+#define EMPTY_MAP ( ~ ( 0u ) )
+
+#define SLAB_LIST_TERMINATOR 0x80
+
+/**
+ * Assumed size of processor cache line.
+ * Data written by different threads is aligned to it to avoid false sharing.
+ */
+#define CACHE_LINE_SIZE 64
+
+/**
+ * Number of occupancy buckets for partially filled chunks.
+ * Partially filled chunks are spread over buckets according to the number of
+ * free slots they have. Bucket 0 holds the fullest chunks.
+ * @see slab_list_t
+ */
+#define PARTIAL_BUCKETS_NUM 8
+
+/**
+ * Structure represents set of chunk lists.
+ * Chunks are kept in double linked lists according to their occupancy.
+ * Absolutely free chunks are placed to free_list, saturated ones are placed
+ * to full_list and all the others are bucketed in partial_list by number of
+ * free slots they have. Allocation is always performed from the fullest
+ * non-full chunk (the first non-empty bucket); free chunk is taken only if
+ * there are no partially filled chunks at all. Thereby, nearly empty chunks
+ * aren't picked for allocation and have a chance to drain completely and
+ * to be evicted by pool_reap. Each time chunk crosses bucket boundary during
+ * allocation or releasing of the block it's moved to the head of
+ * corresponding list. All these operations are performed in constant time.
  * @see slab_t
  * @see cache_t
  */
 typedef struct {
-	slab_t *free_list;
-	slab_t *partial_list;
-	slab_t *full_list;
+	slab_t *free_list; /**< Chunks without allocated blocks.*/
+	slab_t *partial_list[ PARTIAL_BUCKETS_NUM ]; /**< Partially filled
+													chunks bucketed by
+													occupancy.*/
+	slab_t *full_list; /**< Saturated chunks.*/
+	slab_t *hot; /**< Chunk which block has been released last. Used by
+					SLAB_LIFO allocation policy.*/
 } slab_list_t;
 
 static inline void *_bzero( size_t sz ) {
@@ -69,23 +121,119 @@ static inline void *_bzero( size_t sz ) {
 	return b;
 }
 
-static inline void _evict_slab_list( slab_list_t *sl,
-	void ( *dtor )( void *obj, void *ctag ),
-	void *ctag
-) {
-	_purge_slab_chain( sl->free_list, dtor, ctag );
+extern slab_t *_alloc_slab( cache_t *cache );
+
+extern void _free_slab( cache_t *cache, slab_t *slab );
+
+extern void _purge_slab_chain( cache_t *cache, slab_t *sc );
+
+extern void _free_slab_list( cache_t *cache, slab_list_t *sl );
+
+extern size_t _collect_slabs( slab_list_t *sl, slab_t **out );
+
+// cache which chunks are charged to
+static inline cache_t *_get_chunk_owner( cache_t *cache ) {
+	return ( cache->cache_class.get_owner != NULL ) ?
+		cache->cache_class.get_owner( cache ) :
+		cache;
+}
+
+static inline void _evict_slab_list( cache_t *cache, slab_list_t *sl ) {
+	POOL_PROBE2( reap__start, cache, sl );
+	POOL_TIMER_START( started );
+
+	_purge_slab_chain( cache, sl->free_list );
 	sl->free_list = NULL;
+	sl->hot = NULL;
+
+	POOL_TIMER_STOP( cache, POOL_REAP, started );
+	POOL_PROBE2( reap__done, cache, sl );
+}
+
+// SLAB chunk should be aligned in the way that the first slot in it would
+// meet requested alignment
+static inline size_t _get_slab_align( cache_t *cache ) {
+	return ( cache->align > SLAB_ALIGNMENT ) ? cache->align : SLAB_ALIGNMENT;
+}
+
+static inline size_t _get_slab_size( cache_t *cache ) {
+	return cache->header_sz + cache->blk_sz * SLOTS_NUM;
+}
+
+static inline unsigned int _get_free_slots( slab_t *s ) {
+	return __builtin_popcount( ( unsigned int ) s->map );
+}
+
+static inline unsigned int _get_partial_bucket( unsigned int nfree ) {
+	assert( ( nfree > 0 ) && ( nfree < SLOTS_NUM ) );
+	return ( ( nfree - 1 ) * PARTIAL_BUCKETS_NUM ) / ( SLOTS_NUM - 1 );
 }
 
-extern void _purge_slab_chain( slab_t *sc,
-	void ( *dtor )( void *obj, void *ctag ),
-	void *ctag
-);
+// returns the head of the list which slab with nfree free slots belongs to
+static inline slab_t **_get_slab_chain( slab_list_t *sl, unsigned int nfree ) {
+	if( nfree == 0 )
+		return &( sl->full_list );
 
-extern void _free_slab_list( slab_list_t *sl,
-	void ( *dtor )( void *obj, void *ctag ),
-	void *ctag
-);
+	if( nfree == SLOTS_NUM )
+		return &( sl->free_list );
+
+	return &( sl->partial_list[ _get_partial_bucket( nfree ) ] );
+}
+
+static inline void _link_slab( slab_t **chain, slab_t *s ) {
+	s->prev = NULL;
+	if( ( s->next = *chain ) != NULL )
+		( *chain )->prev = s;
+
+	*chain = s;
+}
+
+static inline void _unlink_slab( slab_t **chain, slab_t *s ) {
+	if( s->prev != NULL )
+		s->prev->next = s->next;
+	else
+		*chain = s->next;
+
+	if( s->next != NULL )
+		s->next->prev = s->prev;
+
+	s->next = s->prev = NULL;
+}
+
+// moves slab to another list if its occupancy crossed bucket boundary
+static inline void _refile_slab( slab_list_t *sl,
+	slab_t *s,
+	unsigned int was_free,
+	unsigned int now_free
+) {
+	slab_t **from = _get_slab_chain( sl, was_free );
+	slab_t **to = _get_slab_chain( sl, now_free );
+
+	if( from != to ) {
+		_unlink_slab( from, s );
+		_link_slab( to, s );
+	}
+}
+
+// the fullest slab which still has free slots; NULL if there are no
+// partially filled slabs
+static inline slab_t *_get_fullest_slab( slab_list_t *sl ) {
+	for( unsigned int cyc = 0; cyc < PARTIAL_BUCKETS_NUM; ++cyc )
+		if( sl->partial_list[ cyc ] != NULL )
+			return sl->partial_list[ cyc ];
+
+	return NULL;
+}
+
+// the least occupied slab among partially filled ones; NULL if there are no
+// partially filled slabs
+static inline slab_t *_get_emptiest_slab( slab_list_t *sl ) {
+	for( unsigned int cyc = PARTIAL_BUCKETS_NUM; cyc > 0; --cyc )
+		if( sl->partial_list[ cyc - 1 ] != NULL )
+			return sl->partial_list[ cyc - 1 ];
+
+	return NULL;
+}
 
 static inline  counter_t *_get_counter_ptr( cache_t *cache, void *blk ) {
 	// tricky, right? here, we find the address of reference counter
@@ -100,6 +248,44 @@ static inline  counter_t *_get_counter_ptr( cache_t *cache, void *blk ) {
 	);
 }
 
+// takes mutex on behalf of cache; contended acquisition is the slow path
+// worth to be traced, its wait is accounted in the cache and stored to
+// waited if it isn't NULL (0 means there was no contention)
+static inline int _lock_mutex( pthread_mutex_t *m,
+	cache_t *cache,
+	uint64_t *waited
+) {
+	if( waited != NULL )
+		*waited = 0;
+
+	int rc = pthread_mutex_trylock( m );
+	if( rc != EBUSY )
+		return rc;
+
+	int timed = ( waited != NULL );
+	#if LIBMEMPOOL_HISTOGRAMS
+		timed = 1;
+	#endif
+
+	POOL_PROBE1( lock__wait__start, cache );
+	uint64_t started = timed ? _get_time_ns() : 0;
+
+	rc = pthread_mutex_lock( m );
+
+	uint64_t ns = timed ? ( _get_time_ns() - started ) : 0;
+	POOL_PROBE1( lock__wait__done, cache );
+
+	#if LIBMEMPOOL_HISTOGRAMS
+		_record_latency( cache, POOL_LOCK_WAIT, ns );
+	#endif
+
+	// contended acquisition is never reported as uncontended one
+	if( waited != NULL )
+		*waited = ns ? ns : 1;
+
+	return rc;
+}
+
 #ifdef __cplusplus
 	}
 #endif
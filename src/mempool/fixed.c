@@ -0,0 +1,131 @@
+#include <mempool/fixed.h>
+#include <mempool/common.h>
+
+#include <mempool.h>
+
+#include <stdalign.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Region arena.
+ * Placed at the beginning of caller-provided region. Chunks are carved
+ * contiguously after it; released chunks are kept in stack.
+ * @see fixed_cache_t
+ */
+typedef struct {
+	char *next; /**< Beginning of the region tail which isn't carved yet.*/
+	char *end; /**< End of the region.*/
+	size_t stride; /**< Chunk size with padding.*/
+	void *free_chunks; /**< Stack of released chunks.*/
+} region_arena_t;
+
+/**
+ * Fixed-capacity cache.
+ * It's the simple cache which chunks are placed in caller-provided region.
+ * @see cache_t
+ * @see slab_list_t
+ * @see pool_create_in
+ */
+typedef struct {
+	cache_t abstract_cache; /**< Cache header.*/
+	slab_list_t slab_list; /**< Slab list.*/
+} fixed_cache_t;
+
+static inline uintptr_t _round_ptr( uintptr_t p, size_t align ) {
+	return ( p + align - 1 ) & ( ~( ( uintptr_t ) align - 1 ) );
+}
+
+static void *_region_slab_alloc( void *arena, size_t sz, size_t align ) {
+	region_arena_t *a = arena;
+	void *ret = a->free_chunks;
+
+	assert( sz <= a->stride );
+
+	if( ret != NULL ) {
+		a->free_chunks = *( ( void** ) ret );
+		return ret;
+	}
+
+	if( ( a->next > a->end ) || ( ( size_t ) ( a->end - a->next ) < a->stride ) )
+		return NULL;
+
+	ret = a->next;
+	a->next += a->stride;
+
+	return ret;
+}
+
+static void _region_slab_free( void *arena, void *slab ) {
+	region_arena_t *a = arena;
+
+	*( ( void** ) slab ) = a->free_chunks;
+	a->free_chunks = slab;
+}
+
+cache_t *pool_create_in( void *region,
+	size_t size,
+	slab_class_t *slab_class,
+	unsigned int options
+) {
+	assert( region != NULL );
+	assert( !( options & SLAB_HUGE_PAGES ) );
+
+	fixed_cache_t *c = _bzero( sizeof( fixed_cache_t ) );
+	_pool_init( c, slab_class, &_G_fixed_cache, options, 0 );
+
+	size_t align = _get_slab_align( c );
+	char *begin = ( char* ) _round_ptr( ( uintptr_t ) region,
+		alignof( region_arena_t )
+	);
+	char *end = ( ( char* ) region ) + size;
+
+	if( begin + sizeof( region_arena_t ) > end ) {
+		free( c );
+		return NULL;
+	}
+
+	region_arena_t *a = ( region_arena_t* ) begin;
+	a->next = ( char* ) _round_ptr( ( uintptr_t ) ( a + 1 ), align );
+	a->end = end;
+	a->stride = _adjust_align( _get_slab_size( c ), align );
+	a->free_chunks = NULL;
+
+	c->abstract_cache.slab_source.slab_alloc = _region_slab_alloc;
+	c->abstract_cache.slab_source.slab_free = _region_slab_free;
+	c->abstract_cache.slab_source.arena_destroy = NULL;
+	// region arena isn't locked; cache is the only user of it
+	c->abstract_cache.slab_source.concurrent = 0;
+	c->abstract_cache.slab_source.arena = a;
+
+	// the whole region is carved and constructed right now; after that
+	// allocation slow path is just failure of _region_slab_alloc
+	slab_t *s = NULL;
+	while( ( s = _alloc_slab( c ) ) != NULL )
+		_link_slab( &( c->slab_list.free_list ), s );
+
+	if( c->slab_list.free_list == NULL ) {
+		free( c );
+		return NULL;
+	}
+
+	return c;
+}
+
+static slab_list_t *_get_fixed_slab_list( cache_t *cache ) {
+	return &( ( ( fixed_cache_t* ) cache )->slab_list );
+}
+
+// chunks belong to the region till the cache is destroyed
+static void _pool_fixed_evict( cache_t *c ) { }
+
+static void _pool_fixed_destroy( cache_t *c ) {
+	_free_slab_list( c, _get_fixed_slab_list( c ) );
+}
+
+static cache_class_t _G_fixed_cache = {
+	.get_slab_list = _get_fixed_slab_list,
+	.release_slab_list = NULL,
+	.pool_destroy = _pool_fixed_destroy,
+	.pool_evict = _pool_fixed_evict
+};
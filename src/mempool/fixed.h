@@ -0,0 +1,35 @@
+#ifndef LIBMEMPOOL_FIXED_H
+#define LIBMEMPOOL_FIXED_H
+
+#include <mempool.h>
+
+/**
+ * Creates fixed-capacity cache over caller-provided memory.
+ * All chunks are laid out contiguously inside region (static array, mlock'ed
+ * buffer, huge page mapping and so on) and constructed right here, so neither
+ * memory backend nor object constructors are invoked after creation. Cache
+ * capacity is number of chunks fitting into region multiplied by number of
+ * slots in chunk; when it's exhausted allocation returns NULL immediately.
+ * Every allocation and release is bounded by a few bitmap operations and
+ * scan of PARTIAL_BUCKETS_NUM occupancy buckets. Chunks are never returned
+ * to region, so pool_reap does nothing. Only cache handle is allocated with
+ * memory backend (during creation; it's released by pool_free). Cache isn't
+ * thread-safe like the simple one. SLAB_HUGE_PAGES option isn't supported:
+ * use huge page mapping as region instead.
+ * @param region memory chunks will be placed in; it must outlive the cache
+ * @param size region size in bytes
+ * @param slab_class SLAB object class
+ * @param options cache options
+ * @return !=NULL - it will be cache object; NULL - region can't hold even
+ * 			a single chunk or something went wrong
+ * @see pool_free
+ * @see cache_t
+ * @see slab_class_t
+ */
+extern cache_t *pool_create_in( void *region,
+	size_t size,
+	slab_class_t *slab_class,
+	unsigned int options
+);
+
+#endif
@@ -0,0 +1,360 @@
+#include <mempool/hugepage.h>
+#include <mempool/common.h>
+
+#include <mempool.h>
+
+#include <sys/mman.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#define HUGE_PAGE_SIZE ( 2ul << 20 )
+
+/**
+ * Huge page region header.
+ * Region is HUGE_PAGE_SIZE-aligned chunk of memory. Its header is placed at
+ * the very beginning, chunks are following it contiguously. So header can be
+ * found from chunk address by simple masking.
+ * @see huge_arena_t
+ */
+typedef struct _huge_region_t {
+	struct _huge_region_t *next; /**< Next region in arena.*/
+	struct _huge_region_t *prev; /**< Previous region in arena.*/
+	struct _huge_region_t *avail_next; /**< Next region with free chunks.*/
+	struct _huge_region_t *avail_prev; /**< Previous region with free
+											chunks.*/
+	void *free_chunks; /**< Stack of released chunks.*/
+	unsigned int ncarved; /**< Number of chunks carved so far.*/
+	unsigned int nused; /**< Number of chunks in use.*/
+	int huge_tlb; /**< Whether region is mapped with explicit huge pages.*/
+	int thp; /**< Whether region is asked to be backed with transparent huge
+				pages.*/
+} huge_region_t;
+
+/**
+ * Huge page arena.
+ * Arena serves chunks of the same size for the single cache. Chunks are
+ * carved from regions contiguously; released chunks are reused first.
+ * Region is unmapped as soon as its last chunk is released unless it's the
+ * last region in arena.
+ * @see huge_region_t
+ */
+typedef struct {
+	pthread_mutex_t protect; /**< Chunks may be requested by several zones
+								simultaneously.*/
+	size_t stride; /**< Chunk size with padding.*/
+	size_t first; /**< Offset of the first chunk in region.*/
+	unsigned int nchunks; /**< Number of chunks in region.*/
+	huge_region_t *regions; /**< All regions.*/
+	huge_region_t *avail; /**< Regions which have free chunks.*/
+	size_t reserved; /**< Bytes mapped.*/
+	size_t huge_tlb; /**< Bytes mapped with explicit huge pages.*/
+	int zero; /**< Whether chunks should be zero-filled when they are
+					handed out.*/
+} huge_arena_t;
+
+static inline size_t _round_up( size_t sz, size_t align ) {
+	return ( sz + align - 1 ) & ( ~( align - 1 ) );
+}
+
+static void *_map_region( int *huge_tlb, int *thp ) {
+	void *p = MAP_FAILED;
+
+	*thp = 0;
+
+	#ifdef MAP_HUGETLB
+		// explicit huge pages are used if administrator reserved some
+		int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+		#ifdef MAP_HUGE_2MB
+			flags |= MAP_HUGE_2MB;
+		#endif
+		p = mmap( NULL, HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, flags, -1, 0 );
+	#endif
+
+	if( ( *huge_tlb = ( p != MAP_FAILED ) ) )
+		return p;
+
+	// otherwise we map twice as much as needed and cut 2 MB-aligned
+	// window out of it; transparent huge pages can be used for such window
+	char *raw = mmap( NULL,
+		HUGE_PAGE_SIZE * 2,
+		PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS,
+		-1,
+		0
+	);
+
+	if( raw == MAP_FAILED )
+		return NULL;
+
+	char *aligned = ( char* ) _round_up( ( uintptr_t ) raw, HUGE_PAGE_SIZE );
+	if( aligned > raw )
+		munmap( raw, aligned - raw );
+
+	if( aligned + HUGE_PAGE_SIZE < raw + HUGE_PAGE_SIZE * 2 )
+		munmap( aligned + HUGE_PAGE_SIZE,
+			( raw + HUGE_PAGE_SIZE * 2 ) - ( aligned + HUGE_PAGE_SIZE )
+		);
+
+	#ifdef MADV_HUGEPAGE
+		// it's just a hint; if THP is disabled we will have regular pages
+		*thp = !madvise( aligned, HUGE_PAGE_SIZE, MADV_HUGEPAGE );
+	#endif
+
+	return aligned;
+}
+
+static inline void _avail_link( huge_arena_t *a, huge_region_t *r ) {
+	r->avail_prev = NULL;
+	if( ( r->avail_next = a->avail ) != NULL )
+		a->avail->avail_prev = r;
+
+	a->avail = r;
+}
+
+static inline void _avail_unlink( huge_arena_t *a, huge_region_t *r ) {
+	if( r->avail_prev != NULL )
+		r->avail_prev->avail_next = r->avail_next;
+	else
+		a->avail = r->avail_next;
+
+	if( r->avail_next != NULL )
+		r->avail_next->avail_prev = r->avail_prev;
+}
+
+static huge_region_t *_add_region( huge_arena_t *a ) {
+	int huge_tlb = 0, thp = 0;
+	huge_region_t *r = _map_region( &huge_tlb, &thp );
+	if( r == NULL )
+		return NULL;
+
+	memset( r, 0, sizeof( huge_region_t ) );
+	r->huge_tlb = huge_tlb;
+	r->thp = thp;
+
+	if( ( r->next = a->regions ) != NULL )
+		a->regions->prev = r;
+
+	a->regions = r;
+	_avail_link( a, r );
+
+	a->reserved += HUGE_PAGE_SIZE;
+	if( huge_tlb )
+		a->huge_tlb += HUGE_PAGE_SIZE;
+
+	return r;
+}
+
+static void _remove_region( huge_arena_t *a, huge_region_t *r ) {
+	_avail_unlink( a, r );
+
+	if( r->prev != NULL )
+		r->prev->next = r->next;
+	else
+		a->regions = r->next;
+
+	if( r->next != NULL )
+		r->next->prev = r->prev;
+
+	a->reserved -= HUGE_PAGE_SIZE;
+	if( r->huge_tlb )
+		a->huge_tlb -= HUGE_PAGE_SIZE;
+
+	munmap( r, HUGE_PAGE_SIZE );
+}
+
+static void *_huge_slab_alloc( void *arena, size_t sz, size_t align ) {
+	huge_arena_t *a = arena;
+	void *ret = NULL;
+
+	assert( sz <= a->stride );
+
+	pthread_mutex_lock( &( a->protect ) );
+
+	huge_region_t *r = a->avail;
+	if( ( r == NULL ) && ( ( r = _add_region( a ) ) == NULL ) ) {
+		pthread_mutex_unlock( &( a->protect ) );
+		return NULL;
+	}
+
+	// released chunks go first; they are likely to be warm
+	if( r->free_chunks != NULL ) {
+		ret = r->free_chunks;
+		r->free_chunks = *( ( void** ) ret );
+		// the rest of chunk has been cleared on release
+		if( a->zero )
+			*( ( void** ) ret ) = NULL;
+	} else
+		ret = ( ( char* ) r ) + a->first + a->stride * ( r->ncarved++ );
+
+	if( ( ++( r->nused ) ) == a->nchunks )
+		_avail_unlink( a, r );
+
+	pthread_mutex_unlock( &( a->protect ) );
+
+	return ret;
+}
+
+// whole pages of chunk are returned to the kernel, so they will be supplied
+// zero-filled on the next touch; only partial pages are cleared by hand;
+// huge page (explicit or transparent one) is cleared by hand entirely since
+// returning part of it would split it
+static void _zero_chunk( huge_arena_t *a, huge_region_t *r, char *chunk ) {
+	size_t page = ( size_t ) sysconf( _SC_PAGESIZE );
+	char *start = ( char* ) _round_up( ( uintptr_t ) chunk, page );
+	char *end = ( char* ) (
+		( ( uintptr_t ) chunk + a->stride ) & ( ~( page - 1 ) )
+	);
+
+	if( r->huge_tlb ||
+		r->thp ||
+		( start >= end ) ||
+		madvise( start, end - start, MADV_DONTNEED )
+	) {
+		memset( chunk, 0, a->stride );
+		return;
+	}
+
+	memset( chunk, 0, start - chunk );
+	memset( end, 0, ( chunk + a->stride ) - end );
+}
+
+static void _huge_slab_free( void *arena, void *slab ) {
+	huge_arena_t *a = arena;
+	huge_region_t *r = ( huge_region_t* ) (
+		( ( uintptr_t ) slab ) & ( ~( HUGE_PAGE_SIZE - 1 ) )
+	);
+
+	// region can't go away while chunk is in use, so it's done unlocked
+	if( a->zero )
+		_zero_chunk( a, r, slab );
+
+	pthread_mutex_lock( &( a->protect ) );
+
+	if( ( r->nused-- ) == a->nchunks )
+		_avail_link( a, r );
+
+	if( ( r->nused == 0 ) && ( a->regions != r || r->next != NULL ) )
+		_remove_region( a, r );
+	else {
+		*( ( void** ) slab ) = r->free_chunks;
+		r->free_chunks = slab;
+	}
+
+	pthread_mutex_unlock( &( a->protect ) );
+}
+
+static void _huge_arena_destroy( void *arena ) {
+	huge_arena_t *a = arena;
+
+	// full regions aren't linked to avail list, so we don't bother with
+	// bookkeeping here
+	huge_region_t *next = NULL;
+	for( huge_region_t *r = a->regions; r != NULL; r = next ) {
+		next = r->next;
+		munmap( r, HUGE_PAGE_SIZE );
+	}
+
+	pthread_mutex_destroy( &( a->protect ) );
+	free( a );
+}
+
+int _huge_source_init( cache_t *cache ) {
+	size_t align = _get_slab_align( cache );
+	size_t first = _round_up( sizeof( huge_region_t ), align );
+	size_t stride = _round_up( _get_slab_size( cache ), align );
+
+	// chunk should fit into region along with region header
+	if( ( align > HUGE_PAGE_SIZE ) || ( first + stride > HUGE_PAGE_SIZE ) )
+		return -1;
+
+	huge_arena_t *a = malloc( sizeof( huge_arena_t ) );
+	if( a == NULL )
+		return -1;
+
+	memset( a, 0, sizeof( huge_arena_t ) );
+	pthread_mutex_init( &( a->protect ), NULL );
+	a->first = first;
+	a->stride = stride;
+	a->nchunks = ( HUGE_PAGE_SIZE - first ) / stride;
+	// fresh regions are zero-filled by the kernel
+	a->zero = ( cache->options & SLAB_ZERO ) != 0;
+
+	cache->slab_source.slab_alloc = _huge_slab_alloc;
+	cache->slab_source.slab_free = _huge_slab_free;
+	cache->slab_source.arena_destroy = _huge_arena_destroy;
+	cache->slab_source.zeroed = a->zero;
+	cache->slab_source.concurrent = 1;
+	cache->slab_source.arena = a;
+
+	return 0;
+}
+
+// how many bytes of [ start, end ) belong to arena regions relying on
+// transparent huge pages
+static size_t _get_thp_overlap( huge_arena_t *a,
+	uintptr_t start,
+	uintptr_t end
+) {
+	size_t ret = 0;
+
+	for( huge_region_t *r = a->regions; r != NULL; r = r->next ) {
+		uintptr_t rstart = ( uintptr_t ) r;
+		uintptr_t rend = rstart + HUGE_PAGE_SIZE;
+
+		if( r->huge_tlb || ( rend <= start ) || ( rstart >= end ) )
+			continue;
+
+		ret += ( ( rend < end ) ? rend : end ) -
+			( ( rstart > start ) ? rstart : start );
+	}
+
+	return ret;
+}
+
+int pool_hugepage_stats( cache_t *cache, hugepage_stats_t *stats ) {
+	assert( cache != NULL );
+	assert( stats != NULL );
+
+	if( cache->slab_source.slab_alloc != _huge_slab_alloc )
+		return -1;
+
+	huge_arena_t *a = cache->slab_source.arena;
+
+	pthread_mutex_lock( &( a->protect ) );
+
+	stats->reserved = a->reserved;
+	stats->huge_backed = a->huge_tlb;
+
+	// kernel may merge our regions with neighbouring mappings; in such case
+	// huge pages of the mapping are attributed to regions proportionally
+	FILE *f = fopen( "/proc/self/smaps", "r" );
+	if( f != NULL ) {
+		char line[ 256 ];
+		unsigned long start = 0, end = 0;
+		size_t overlap = 0, kb = 0;
+
+		while( fgets( line, sizeof( line ), f ) != NULL ) {
+			unsigned long s = 0, e = 0;
+
+			if( sscanf( line, "%lx-%lx ", &s, &e ) == 2 ) {
+				start = s;
+				end = e;
+				overlap = _get_thp_overlap( a, start, end );
+			} else if( overlap &&
+				( sscanf( line, "AnonHugePages: %zu kB", &kb ) == 1 )
+			)
+				stats->huge_backed += ( size_t ) (
+					( ( double ) kb ) * 1024 * overlap / ( end - start )
+				);
+		}
+
+		fclose( f );
+	}
+
+	pthread_mutex_unlock( &( a->protect ) );
+
+	return 0;
+}
@@ -0,0 +1,37 @@
+#ifndef LIBMEMPOOL_HUGEPAGE_H
+#define LIBMEMPOOL_HUGEPAGE_H
+
+#include <mempool.h>
+
+/**
+ * Huge page arena statistics.
+ * @see pool_hugepage_stats
+ */
+typedef struct {
+	size_t reserved; /**< Bytes mapped by arena for chunks.*/
+	size_t huge_backed; /**< Bytes of reserved memory which are actually
+							backed by huge pages.*/
+} hugepage_stats_t;
+
+/**
+ * Reports how much of cache memory is backed by huge pages.
+ * Regions mapped with explicit huge pages are accounted fully. For regions
+ * relying on transparent huge pages amount is estimated from
+ * AnonHugePages entries in /proc/self/smaps.
+ * @param cache cache created with SLAB_HUGE_PAGES option
+ * @param stats where statistics will be stored
+ * @return 0 - success; -1 - cache doesn't use huge page arena
+ * @see SLAB_HUGE_PAGES
+ */
+extern int pool_hugepage_stats( cache_t *cache, hugepage_stats_t *stats );
+
+/**
+ * Replaces SLAB chunk source of the cache with huge page arena.
+ * Cache geometry should be calculated already.
+ * @param cache cache being initialized
+ * @return 0 - success; -1 - arena can't host chunks of the cache, source is
+ * 			left untouched
+ */
+extern int _huge_source_init( cache_t *cache );
+
+#endif
@@ -13,58 +13,274 @@ typedef struct {
 	pthread_mutex_t protect; /**< Dummy simple global mutex.*/
 } lockable_cache_t;
 
-cache_t *pool_lockable_create( unsigned int options,
+/**
+ * Group of merged caches.
+ * Lockable caches with the same geometry and options and without object
+ * construction semantics share chunks of the single lockable cache (root).
+ * Group lives while there is at least one cache in it.
+ * @see merged_cache_t
+ * @see pool_lockable_create
+ */
+typedef struct _merge_group_t {
+	struct _merge_group_t *next; /**< Next group in registry.*/
+	lockable_cache_t *root; /**< Cache which chunks are shared.*/
+	unsigned int refs; /**< Number of caches in group.*/
+} merge_group_t;
+
+/**
+ * Merged cache.
+ * Handle of the cache which has been merged into group. Handle has its own
+ * identity (for tracing) and lock wait statistics; chunks, budget and
+ * chunk-level statistics belong to the group root.
+ * @see merge_group_t
+ */
+typedef struct {
+	cache_t abstract_cache; /**< Cache header.*/
+	merge_group_t *group; /**< Group cache belongs to.*/
+} merged_cache_t;
+
+static merge_group_t *_G_merge_groups = NULL;
+static pthread_mutex_t _G_merge_protect = PTHREAD_MUTEX_INITIALIZER;
+
+static lockable_cache_t *_lockable_create( unsigned int options,
 	slab_class_t *slab_class,
 	unsigned int inum
 ) {
 	lockable_cache_t *c = _bzero( sizeof( lockable_cache_t ) );
-	
+	if( c == NULL )
+		return NULL;
+
 	pthread_mutex_init( &( c->protect ), NULL );
 	_pool_init( c, slab_class, &_G_lockable_cache, options, inum );
+	_prepopulate_list( c, &( c->slab_list.free_list ), NULL );
 
 	return c;
 }
 
+// objects of merged caches are indistinguishable, so objects can't be
+// constructed, relocated or placed in per-cache arena
+static int _is_mergeable( unsigned int options, slab_class_t *slab_class ) {
+	return !( options & (
+			SLAB_NO_MERGE | SLAB_HUGE_PAGES | SLAB_HANDLES | SLAB_HANDLE_GEN
+		) ) &&
+		( slab_class->ctor == NULL ) &&
+		( slab_class->dtor == NULL ) &&
+		( slab_class->reinit == NULL ) &&
+		( slab_class->reinit_bulk == NULL ) &&
+		( slab_class->move == NULL ) &&
+		( slab_class->ctor_bulk == NULL ) &&
+		( slab_class->dtor_bulk == NULL ) &&
+		( getenv( "LIBMEMPOOL_NO_MERGE" ) == NULL );
+}
+
+// registry lock must be held
+static merge_group_t *_find_group( cache_t *cache ) {
+	for( merge_group_t *g = _G_merge_groups; g != NULL; g = g->next ) {
+		cache_t *root = &( g->root->abstract_cache );
+
+		// blocks are cleared up to the size requested for root, so
+		// zeroing caches have to request the same size
+		if( ( root->blk_sz == cache->blk_sz ) &&
+			( root->align == cache->align ) &&
+			( root->header_sz == cache->header_sz ) &&
+			( ( root->options & ( ~SLAB_NO_MERGE ) ) == cache->options ) &&
+			( !( cache->options & SLAB_ZERO ) ||
+				( root->slab_class.blk_sz == cache->slab_class.blk_sz ) )
+		)
+			return g;
+	}
+
+	return NULL;
+}
+
+cache_t *pool_lockable_create( unsigned int options,
+	slab_class_t *slab_class,
+	unsigned int inum
+) {
+	if( ! _is_mergeable( options, slab_class ) ) {
+		lockable_cache_t *c = _lockable_create( options, slab_class, inum );
+		return ( c == NULL ) ? NULL : &( c->abstract_cache );
+	}
+
+	merged_cache_t *c = _bzero( sizeof( merged_cache_t ) );
+	if( c == NULL )
+		return NULL;
+
+	_pool_init( c, slab_class, &_G_merged_cache, options, inum );
+
+	pthread_mutex_lock( &_G_merge_protect );
+
+	merge_group_t *g = _find_group( &( c->abstract_cache ) );
+	if( g == NULL ) {
+		// root is never merged itself, so it's always plain lockable cache;
+		// mergeable cache has no arena or chunk table, so nothing but the
+		// header has to be freed on failure
+		if( ( ( g = malloc( sizeof( merge_group_t ) ) ) == NULL ) ||
+			( ( g->root = _lockable_create( options | SLAB_NO_MERGE,
+				slab_class,
+				inum
+			) ) == NULL )
+		) {
+			pthread_mutex_unlock( &_G_merge_protect );
+			free( g );
+			free( c );
+			return NULL;
+		}
+
+		g->refs = 0;
+		g->next = _G_merge_groups;
+		_G_merge_groups = g;
+	}
+
+	++( g->refs );
+	c->group = g;
+
+	pthread_mutex_unlock( &_G_merge_protect );
+
+	return &( c->abstract_cache );
+}
+
+// lock wait is accounted in the cache lock is taken on behalf of
+static slab_list_t *_lock_slab_list( lockable_cache_t *c, cache_t *cache ) {
+	int rc = _lock_mutex( &( c->protect ), cache, NULL );
+
+	// what would you do if the cache is freed already? NULL is a way
+	// to get an idea about this fact
+	if( rc )
+		return NULL;
+
+	return &( c->slab_list );
+}
+
 static slab_list_t *_get_lockable_slab_list( cache_t *cache ) {
-	slab_list_t *sl = &( ( ( lockable_cache_t* ) cache )->slab_list );
-	
-	if( sl->free_list == NULL )
-		_prepopulate_list( cache, &( sl->free_list ), NULL );
-	
-	return sl;
+	return _lock_slab_list( ( lockable_cache_t* ) cache, cache );
+}
+
+static void _release_lockable_slab_list( cache_t *cache, slab_list_t *sl ) {
+	pthread_mutex_unlock( &( ( ( lockable_cache_t* ) cache )->protect ) );
 }
 
 static void _pool_lockable_evict( cache_t *c ) {
-	// what would you do if the cache is freed already? this branch a way
-	// to get an idea about this fact
-	if( pthread_mutex_lock( &( cache->protect ) ) )
+	slab_list_t *sl = _get_lockable_slab_list( c );
+	if( sl == NULL )
 		return;
 
-	_evict_slab_list( _get_simple_slab_list( c ),
-		c->slab_class.dtor,
-		c->slab_class.ctag
-	);
+	_evict_slab_list( c, sl );
 
-	pthread_mutex_unlock( &( cache->protect ) );
+	_release_lockable_slab_list( c, sl );
 }
 
 static void _pool_lockable_destroy( cache_t *c ) {
-	// what would you do if the cache is freed already? this branch a way
-	// to get an idea about this fact
-	if( pthread_mutex_lock( &( cache->protect ) ) )
+	slab_list_t *sl = _get_lockable_slab_list( c );
+	if( sl == NULL )
 		return;
 
-	_free_slab_list( _get_simple_slab_list( c ),
-		c->slab_class.dtor,
-		c->slab_class.ctag
-	);
+	_free_slab_list( c, sl );
 	
-	pthread_mutex_unlock( &( cache->protect ) );
-	pthread_mutex_destroy( &( cache->protect ) );
+	_release_lockable_slab_list( c, sl );
+	pthread_mutex_destroy( &( ( ( lockable_cache_t* ) c )->protect ) );
 }
 
 static cache_class_t _G_lockable_cache = {
 	.get_slab_list = _get_lockable_slab_list,
+	.release_slab_list = _release_lockable_slab_list,
 	.pool_evict = _pool_lockable_evict,
 	.pool_destroy = _pool_lockable_destroy
 };
+
+static inline lockable_cache_t *_get_root( cache_t *cache ) {
+	return ( ( merged_cache_t* ) cache )->group->root;
+}
+
+// budget and reserve are kept by root since it creates chunks
+static cache_t *_get_merged_owner( cache_t *cache ) {
+	return &( _get_root( cache )->abstract_cache );
+}
+
+static slab_list_t *_get_merged_slab_list( cache_t *cache ) {
+	return _lock_slab_list( _get_root( cache ), cache );
+}
+
+static void _release_merged_slab_list( cache_t *cache, slab_list_t *sl ) {
+	pthread_mutex_unlock( &( _get_root( cache )->protect ) );
+}
+
+// chunks are created and destroyed on behalf of root, so chunk accounting
+// stays consistent whichever cache of the group does it
+static void *_merged_object_alloc( cache_t *cache ) {
+	lockable_cache_t *root = _get_root( cache );
+	slab_list_t *sl = _lock_slab_list( root, cache );
+	if( sl == NULL )
+		return NULL;
+
+	void *ret = _alloc_block( &( root->abstract_cache ), sl );
+	_release_merged_slab_list( cache, sl );
+
+	return ret;
+}
+
+static void *_merged_object_get( cache_t *cache, void *obj ) {
+	if( cache->options & SLAB_REFERABLE ) {
+		lockable_cache_t *root = _get_root( cache );
+		slab_list_t *sl = _lock_slab_list( root, cache );
+		if( sl == NULL )
+			return NULL;
+
+		_inc_refcount( &( root->abstract_cache ), obj );
+		_release_merged_slab_list( cache, sl );
+	}
+
+	return obj;
+}
+
+static void *_merged_object_put( cache_t *cache, void *obj ) {
+	lockable_cache_t *root = _get_root( cache );
+	slab_list_t *sl = _lock_slab_list( root, cache );
+	if( sl == NULL )
+		return NULL;
+
+	obj = _put_block( &( root->abstract_cache ), sl, obj );
+	_release_merged_slab_list( cache, sl );
+
+	return obj;
+}
+
+static void _pool_merged_evict( cache_t *c ) {
+	_pool_lockable_evict( &( _get_root( c )->abstract_cache ) );
+}
+
+// chunks (and objects of this cache which haven't been put back) stay in
+// group until the last cache of the group is destroyed
+static void _pool_merged_destroy( cache_t *c ) {
+	merge_group_t *g = ( ( merged_cache_t* ) c )->group;
+
+	pthread_mutex_lock( &_G_merge_protect );
+
+	int last = ( --( g->refs ) == 0 );
+	if( last )
+		for( merge_group_t **link = &_G_merge_groups; *link != NULL;
+			link = &( ( *link )->next )
+		)
+			if( *link == g ) {
+				*link = g->next;
+				break;
+			}
+
+	pthread_mutex_unlock( &_G_merge_protect );
+
+	if( last ) {
+		pool_free( &( g->root->abstract_cache ) );
+		free( g );
+	}
+}
+
+static cache_class_t _G_merged_cache = {
+	.get_slab_list = _get_merged_slab_list,
+	.release_slab_list = _release_merged_slab_list,
+	.pool_evict = _pool_merged_evict,
+	.pool_destroy = _pool_merged_destroy,
+	.object_alloc = _merged_object_alloc,
+	.object_get = _merged_object_get,
+	.object_put = _merged_object_put,
+	.get_owner = _get_merged_owner
+};
@@ -3,6 +3,29 @@
 
 #include <mempool.h>
 
+/**
+ * Creates thread-safe cache protected with single mutex.
+ * Caches without object construction semantics (no ctor, dtor, reinit, move
+ * and their batched versions) which have the same block geometry and options
+ * after adjustments are merged: they share chunks of the single underlying
+ * cache instead of keeping their own mostly empty chunks. Each merged cache
+ * still has its own handle, trace identity and lock wait statistics; chunk
+ * budget, refiller and chunk-level statistics are kept by the group
+ * (pool_set_budget and pool_refiller_attach on any cache of the group apply
+ * to the whole group). Zeroing caches are merged only if they request the
+ * same object size. Initial size of the group is the one of its first cache.
+ * pool_reap of any cache in group evicts free chunks of the whole group;
+ * chunks are released when the last cache of the group is destroyed. Merging
+ * can be disabled per cache with SLAB_NO_MERGE and globally with
+ * LIBMEMPOOL_NO_MERGE environment variable (to find out which cache corrupts
+ * objects, for example). SLAB_HUGE_PAGES and SLAB_HANDLES caches are never
+ * merged.
+ * @param options cache options
+ * @param slab_class SLAB object class
+ * @param inum number of blocks will be reserved for immediate use
+ * @return !=NULL - it will be cache object; NULL - something went wrong
+ * @see pool_free
+ */
 extern cache_t *pool_lockable_create( unsigned int options,
 	slab_class_t *slab_class,
 	unsigned int inum
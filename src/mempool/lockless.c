@@ -177,7 +177,7 @@ static void _push_free_list( slab_t* volatile *stack,
 
 void *pool_object_alloc( lockless_cache_t *cache ) {
 	
-	slab_t *slab = AO_load_full( &( cache->slab_list.partial_list ) );
+	slab_t *slab = AO_load_full( &( cache->slab_list.partial_list[ 0 ] ) );
 	
 	if( slab == NULL ) {
 		slab = _pop_free_list( &( cache->slab_list.free_list ), hptrs );
@@ -236,7 +236,7 @@ static void _pool_lockless_evict( cache_t *c ) {
 		! AO_compare_and_swap_full( &( sl->free_list ), flist, NULL )
 	);
 
-	_purge_slab_chain( flist, c->slab_class.dtor, c->slab_class.ctag );
+	_purge_slab_chain( c, flist );
 }
 
 static cache_class_t _G_lockless_cache = {
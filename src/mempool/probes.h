@@ -0,0 +1,80 @@
+#ifndef LIBMEMPOOL_PROBES_H
+#define LIBMEMPOOL_PROBES_H
+
+#include <mempool.h>
+
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Static tracing points on allocator slow paths.
+ * With LIBMEMPOOL_USDT probes are compiled as USDT (SystemTap SDT) notes in
+ * "libmempool" provider. Disabled probe costs a single nop, so they can be
+ * kept in production builds and attached with bpftrace or perf when needed:
+ * bpftrace -e 'usdt:./libmempool.so:libmempool:slab__alloc { ... }'
+ */
+#if LIBMEMPOOL_USDT
+	#include <sys/sdt.h>
+
+	#define POOL_PROBE1( name, a ) DTRACE_PROBE1( libmempool, name, a )
+	#define POOL_PROBE2( name, a, b ) DTRACE_PROBE2( libmempool, name, a, b )
+	#define POOL_PROBE3( name, a, b, c ) \
+		DTRACE_PROBE3( libmempool, name, a, b, c )
+#else
+	#define POOL_PROBE1( name, a ) do {} while( 0 )
+	#define POOL_PROBE2( name, a, b ) do {} while( 0 )
+	#define POOL_PROBE3( name, a, b, c ) do {} while( 0 )
+#endif
+
+// monotonic clock; it's used by contention accounting as well
+static inline uint64_t _get_time_ns( void ) {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ( ( uint64_t ) ts.tv_sec ) * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * Latency measurement of allocator slow paths.
+ * With LIBMEMPOOL_HISTOGRAMS duration of slow path is recorded into
+ * log-bucketed histogram of the cache. Otherwise timers expand to nothing.
+ */
+#if LIBMEMPOOL_HISTOGRAMS
+	static inline void _record_latency( cache_t *cache,
+		unsigned int path,
+		uint64_t ns
+	) {
+		// bucket i holds latencies in [ 2^i, 2^(i+1) ) nanoseconds
+		unsigned int bucket = ( ns == 0 ) ? 0 :
+			( 63 - __builtin_clzll( ns ) );
+		if( bucket >= POOL_HISTOGRAM_BUCKETS )
+			bucket = POOL_HISTOGRAM_BUCKETS - 1;
+
+		// zones may hit slow path simultaneously
+		__atomic_fetch_add( &( cache->histograms[ path ][ bucket ] ),
+			1,
+			__ATOMIC_RELAXED
+		);
+	}
+
+	#define POOL_TIMER_START( t ) uint64_t t = _get_time_ns()
+	#define POOL_TIMER_STOP( cache, path, t ) \
+		_record_latency( ( cache ), ( path ), _get_time_ns() - ( t ) )
+#else
+	#define POOL_TIMER_START( t ) do {} while( 0 )
+	#define POOL_TIMER_STOP( cache, path, t ) do {} while( 0 )
+#endif
+
+/*
+ * Allocation trace recording.
+ * With LIBMEMPOOL_TRACE client-visible operations are recorded into
+ * per-thread ring buffer files while recording is started with
+ * pool_trace_start. Otherwise trace points expand to nothing.
+ */
+#if LIBMEMPOOL_TRACE
+	#define POOL_TRACE( type, cache, obj, size ) \
+		_pool_trace_record( ( type ), ( cache ), ( obj ), ( size ) )
+#else
+	#define POOL_TRACE( type, cache, obj, size ) do {} while( 0 )
+#endif
+
+#endif
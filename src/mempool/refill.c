@@ -0,0 +1,258 @@
+#include <mempool/refill.h>
+#include <mempool/common.h>
+
+#include <mempool.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Cache served by refiller.
+ * @see refiller_t
+ */
+typedef struct _refill_entry_t {
+	struct _refill_entry_t *next; /**< Next served cache.*/
+	cache_t *cache; /**< Cache itself.*/
+	unsigned int low; /**< Low watermark of reserve.*/
+	unsigned int high; /**< High watermark of reserve.*/
+	int busy; /**< Reserve is being filled; entry can't be detached.*/
+} refill_entry_t;
+
+struct _refiller_t {
+	pthread_t thread; /**< Helper thread.*/
+	pthread_mutex_t protect; /**< Guards list of caches and stop flag.*/
+	pthread_cond_t wakeup; /**< Helper thread waits on it.*/
+	pthread_cond_t idle; /**< Signalled when reserve filling is done.*/
+	refill_entry_t *caches; /**< Served caches.*/
+	unsigned int period_ms; /**< Maximum interval between checks.*/
+	int stop; /**< Helper thread should exit.*/
+};
+
+// counter is incremented before chunk is published, so it's never lower
+// than actual reserve size
+static void _push_reserve( cache_t *cache, slab_t *s ) {
+	__atomic_add_fetch( &( cache->nreserved ), 1, __ATOMIC_RELAXED );
+
+	slab_t *top = __atomic_load_n( &( cache->reserve ), __ATOMIC_RELAXED );
+	do
+		s->next = top;
+	while(
+		! __atomic_compare_exchange_n( &( cache->reserve ),
+			&top,
+			s,
+			1,
+			__ATOMIC_RELEASE,
+			__ATOMIC_RELAXED
+		)
+	);
+}
+
+// chunks are built with refiller lock released, so attaching and detaching
+// aren't blocked by constructors; entry is marked busy meanwhile, so it
+// can't go away; refiller lock must be held
+static void _fill_reserve( refiller_t *r, refill_entry_t *e ) {
+	cache_t *cache = e->cache;
+	unsigned int n = __atomic_load_n( &( cache->nreserved ), __ATOMIC_RELAXED );
+
+	if( n >= e->low )
+		return;
+
+	e->busy = 1;
+	pthread_mutex_unlock( &( r->protect ) );
+
+	slab_t *built = NULL;
+	for( unsigned int cyc = n; cyc < e->high; ++cyc ) {
+		// the same routine is used by allocation path; budget is respected
+		slab_t *s = _alloc_slab( cache );
+		if( s == NULL )
+			break;
+
+		s->next = built;
+		built = s;
+	}
+
+	pthread_mutex_lock( &( r->protect ) );
+
+	for( slab_t *next = NULL; built != NULL; built = next ) {
+		next = built->next;
+		_push_reserve( cache, built );
+	}
+
+	e->busy = 0;
+	pthread_cond_broadcast( &( r->idle ) );
+}
+
+static void _drain_reserve( cache_t *cache ) {
+	slab_t *s = __atomic_exchange_n( &( cache->reserve ),
+		NULL,
+		__ATOMIC_ACQUIRE
+	);
+
+	for( slab_t *next = NULL; s != NULL; s = next ) {
+		next = s->next;
+		_free_slab( cache, s );
+		__atomic_sub_fetch( &( cache->nreserved ), 1, __ATOMIC_RELAXED );
+	}
+}
+
+static void *_refiller_loop( void *arg ) {
+	refiller_t *r = arg;
+
+	pthread_mutex_lock( &( r->protect ) );
+
+	while( ! r->stop ) {
+		for( refill_entry_t *e = r->caches; e != NULL; e = e->next )
+			_fill_reserve( r, e );
+
+		struct timespec deadline;
+		clock_gettime( CLOCK_REALTIME, &deadline );
+		deadline.tv_sec += r->period_ms / 1000;
+		deadline.tv_nsec += ( r->period_ms % 1000 ) * 1000000l;
+		if( deadline.tv_nsec >= 1000000000l ) {
+			++( deadline.tv_sec );
+			deadline.tv_nsec -= 1000000000l;
+		}
+
+		// spurious and lost wake-ups are fine: the worst case is
+		// the reserve check delayed for period_ms
+		pthread_cond_timedwait( &( r->wakeup ), &( r->protect ), &deadline );
+	}
+
+	pthread_mutex_unlock( &( r->protect ) );
+
+	return NULL;
+}
+
+refiller_t *pool_refiller_create( unsigned int period_ms ) {
+	refiller_t *r = _bzero( sizeof( refiller_t ) );
+	if( r == NULL )
+		return NULL;
+
+	r->period_ms = ( period_ms == 0 ) ? 1 : period_ms;
+	pthread_mutex_init( &( r->protect ), NULL );
+	pthread_cond_init( &( r->wakeup ), NULL );
+	pthread_cond_init( &( r->idle ), NULL );
+
+	if( pthread_create( &( r->thread ), NULL, _refiller_loop, r ) ) {
+		pthread_cond_destroy( &( r->idle ) );
+		pthread_cond_destroy( &( r->wakeup ) );
+		pthread_mutex_destroy( &( r->protect ) );
+		free( r );
+		return NULL;
+	}
+
+	return r;
+}
+
+int pool_refiller_attach( refiller_t *refiller,
+	cache_t *cache,
+	unsigned int low,
+	unsigned int high
+) {
+	assert( refiller != NULL );
+	assert( cache != NULL );
+	assert( high >= low );
+
+	// reserve is taken by the cache which actually creates chunks; other
+	// caches of merged group may have attached it already
+	cache = _get_chunk_owner( cache );
+	if( cache->refiller != NULL )
+		return -1;
+
+	// chunks are created by helper thread while cache may be creating
+	// them too
+	if( ! cache->slab_source.concurrent )
+		return -1;
+
+	refill_entry_t *e = malloc( sizeof( refill_entry_t ) );
+	if( e == NULL )
+		return -1;
+
+	e->cache = cache;
+	e->low = low;
+	e->high = high;
+	e->busy = 0;
+
+	pthread_mutex_lock( &( refiller->protect ) );
+	e->next = refiller->caches;
+	refiller->caches = e;
+	cache->refiller = refiller;
+	pthread_mutex_unlock( &( refiller->protect ) );
+
+	_refiller_wake( refiller );
+
+	return 0;
+}
+
+// refiller lock must be held
+static void _detach_entry( refill_entry_t **link ) {
+	refill_entry_t *e = *link;
+
+	*link = e->next;
+	_drain_reserve( e->cache );
+
+	// allocating threads may be waking refiller up; it's short, so
+	// spinning is fine
+	__atomic_store_n( &( e->cache->refiller ), NULL, __ATOMIC_SEQ_CST );
+	while( __atomic_load_n( &( e->cache->refiller_wakers ), __ATOMIC_SEQ_CST ) )
+		sched_yield();
+
+	free( e );
+}
+
+// refiller lock must be held
+static refill_entry_t **_find_entry( refiller_t *refiller, cache_t *cache ) {
+	for( refill_entry_t **link = &( refiller->caches ); *link != NULL;
+		link = &( ( *link )->next )
+	)
+		if( ( *link )->cache == cache )
+			return link;
+
+	return NULL;
+}
+
+void pool_refiller_detach( refiller_t *refiller, cache_t *cache ) {
+	assert( refiller != NULL );
+	assert( cache != NULL );
+
+	cache = _get_chunk_owner( cache );
+
+	pthread_mutex_lock( &( refiller->protect ) );
+
+	// list may change while we are waiting, so entry is looked up again
+	refill_entry_t **link = _find_entry( refiller, cache );
+	while( ( link != NULL ) && ( *link )->busy ) {
+		pthread_cond_wait( &( refiller->idle ), &( refiller->protect ) );
+		link = _find_entry( refiller, cache );
+	}
+
+	if( link != NULL )
+		_detach_entry( link );
+
+	pthread_mutex_unlock( &( refiller->protect ) );
+}
+
+void pool_refiller_destroy( refiller_t *refiller ) {
+	assert( refiller != NULL );
+
+	pthread_mutex_lock( &( refiller->protect ) );
+	refiller->stop = 1;
+	pthread_cond_signal( &( refiller->wakeup ) );
+	pthread_mutex_unlock( &( refiller->protect ) );
+
+	pthread_join( refiller->thread, NULL );
+
+	while( refiller->caches != NULL )
+		_detach_entry( &( refiller->caches ) );
+
+	pthread_cond_destroy( &( refiller->idle ) );
+	pthread_cond_destroy( &( refiller->wakeup ) );
+	pthread_mutex_destroy( &( refiller->protect ) );
+	free( refiller );
+}
+
+void _refiller_wake( refiller_t *refiller ) {
+	pthread_cond_signal( &( refiller->wakeup ) );
+}
@@ -0,0 +1,78 @@
+#ifndef LIBMEMPOOL_REFILL_H
+#define LIBMEMPOOL_REFILL_H
+
+#include <mempool.h>
+
+/**
+ * Background chunk refiller.
+ * Refiller owns helper thread which keeps reserve of free chunks of attached
+ * caches above low watermark. Chunks are created and constructed by helper
+ * thread and handed over to cache through lock-free stack. When allocation
+ * runs out of free chunks it takes the whole reserve instead of creating
+ * chunk inline (and, in the case of lockable cache, doing so with cache
+ * mutex held); chunk is created inline only if reserve is empty. Reserved
+ * chunks are accounted in cache budget. Chunks are built with refiller lock
+ * released, so slow constructors don't delay attaching and detaching.
+ * @see pool_refiller_create
+ * @see pool_refiller_attach
+ */
+typedef struct _refiller_t refiller_t;
+
+/**
+ * Creates refiller and starts its helper thread.
+ * Helper thread is woken up each time cache takes its reserve and at least
+ * every period_ms milliseconds.
+ * @param period_ms maximum interval between reserve checks
+ * @return !=NULL - refiller; NULL - something went wrong
+ * @see pool_refiller_destroy
+ */
+extern refiller_t *pool_refiller_create( unsigned int period_ms );
+
+/**
+ * Attaches cache to refiller.
+ * When reserve of the cache drops below low chunks it's filled up to high
+ * chunks. Cache can be attached to the single refiller only. Cache which
+ * chunk source can't be used by several threads at once (fixed-capacity
+ * cache) or which doesn't take chunks from it (shared cache) can't be
+ * attached. Merged lockable caches are served as a group:
+ * the first cache of the group attaches it, detaching any of them detaches
+ * the group.
+ * @param refiller refiller
+ * @param cache cache to be served
+ * @param low low watermark in chunks
+ * @param high high watermark in chunks; it should be >= low
+ * @return 0 - success; -1 - something went wrong or cache can't be served
+ * @see pool_refiller_detach
+ */
+extern int pool_refiller_attach( refiller_t *refiller,
+	cache_t *cache,
+	unsigned int low,
+	unsigned int high
+);
+
+/**
+ * Detaches cache from refiller.
+ * Chunks remaining in reserve are released. Cache must be detached before
+ * pool_free.
+ * @param refiller refiller
+ * @param cache cache attached with pool_refiller_attach
+ * @see pool_refiller_attach
+ */
+extern void pool_refiller_detach( refiller_t *refiller, cache_t *cache );
+
+/**
+ * Stops helper thread and destroys refiller.
+ * All caches still attached are detached.
+ * @param refiller refiller
+ * @see pool_refiller_create
+ */
+extern void pool_refiller_destroy( refiller_t *refiller );
+
+/**
+ * Wakes helper thread up.
+ * Called by cache which has taken its reserve.
+ * @param refiller refiller cache is attached to
+ */
+extern void _refiller_wake( refiller_t *refiller );
+
+#endif
@@ -0,0 +1,478 @@
+#include <mempool/shared.h>
+#include <mempool/common.h>
+
+#include <mempool.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+#define SHARED_MAGIC 0x31445248534c504dull
+
+#define SHARED_VERSION 1
+
+/**
+ * SLAB chunk header in shared region.
+ * It mirrors slab_t but links are self-relative: each of them holds the
+ * distance from the link itself to the target chunk; 0 means no chunk.
+ * @see slab_t
+ */
+typedef struct {
+	ptrdiff_t next; /**< Link to the next chunk in list.*/
+	ptrdiff_t prev; /**< Link to the previous chunk in list.*/
+	blockmap_t map; /**< Bitmap of free and occupied blocks.*/
+} shared_slab_t;
+
+// chunk stride and slot offsets are computed by common code from slab_t
+// header size, so shared chunk header must fit into it
+_Static_assert( sizeof( shared_slab_t ) <= sizeof( slab_t ),
+	"shared chunk header doesn't fit into slab_t one"
+);
+
+/**
+ * Set of chunk lists in shared region.
+ * It mirrors slab_list_t with self-relative heads.
+ * @see slab_list_t
+ */
+typedef struct {
+	ptrdiff_t free_list;
+	ptrdiff_t partial_list[ PARTIAL_BUCKETS_NUM ];
+	ptrdiff_t full_list;
+} shared_slab_list_t;
+
+/**
+ * Shared region header.
+ * Placed at the very beginning of the region. Chunks are following it
+ * contiguously and are carved (constructed) on demand.
+ * @see shared_cache_t
+ */
+typedef struct {
+	uint64_t magic; /**< Set when region is formatted completely.*/
+	uint32_t version; /**< Layout version.*/
+	uint32_t options; /**< Cache options region is formatted with.*/
+	uint64_t size; /**< Region size.*/
+	uint64_t obj_sz; /**< Requested object size.*/
+	uint64_t blk_sz; /**< Slot size.*/
+	uint64_t align; /**< Object alignment.*/
+	uint64_t first; /**< Offset of the first chunk.*/
+	uint64_t stride; /**< Chunk size with padding.*/
+	uint64_t nslabs; /**< Region capacity in chunks.*/
+	uint64_t ncarved; /**< Number of chunks constructed so far.*/
+	uint64_t root; /**< Offset of the root object; 0 if there is no one.*/
+	pthread_mutex_t protect; /**< Process-shared robust mutex.*/
+	shared_slab_list_t slab_list; /**< Chunk lists.*/
+} shared_region_t;
+
+/**
+ * Shared cache.
+ * Process-local handle of the shared region.
+ * @see cache_t
+ * @see shared_region_t
+ * @see pool_shared_create
+ */
+typedef struct {
+	cache_t abstract_cache; /**< Cache header.*/
+	shared_region_t *region; /**< Region mapped into process.*/
+	int fd; /**< Backing file; it's locked while cache is attached.*/
+} shared_cache_t;
+
+static inline void *_rel_get( ptrdiff_t *link ) {
+	return ( *link == 0 ) ? NULL : ( ( char* ) link ) + *link;
+}
+
+static inline void _rel_set( ptrdiff_t *link, void *target ) {
+	*link = ( target == NULL ) ? 0 : ( ( char* ) target ) - ( ( char* ) link );
+}
+
+// the first free slot is handed out; LIFO and zeroing policies aren't
+// supported, so the rest of slab_t logic isn't needed
+static inline void *_get_shared_block( cache_t *cache, shared_slab_t *s ) {
+	assert( s->map );
+
+	int slotn = ffs( ( int ) s->map ) - 1;
+	s->map &= ~( 1u << slotn );
+
+	return ( ( char* ) s ) + cache->header_sz + cache->blk_sz * slotn;
+}
+
+static inline unsigned int _get_shared_free_slots( shared_slab_t *s ) {
+	return __builtin_popcount( ( unsigned int ) s->map );
+}
+
+static inline ptrdiff_t *_get_shared_chain( shared_slab_list_t *sl,
+	unsigned int nfree
+) {
+	if( nfree == 0 )
+		return &( sl->full_list );
+
+	if( nfree == SLOTS_NUM )
+		return &( sl->free_list );
+
+	return &( sl->partial_list[ _get_partial_bucket( nfree ) ] );
+}
+
+static inline void _shared_link( ptrdiff_t *chain, shared_slab_t *s ) {
+	shared_slab_t *head = _rel_get( chain );
+
+	s->prev = 0;
+	_rel_set( &( s->next ), head );
+	if( head != NULL )
+		_rel_set( &( head->prev ), s );
+
+	_rel_set( chain, s );
+}
+
+static inline void _shared_unlink( ptrdiff_t *chain, shared_slab_t *s ) {
+	shared_slab_t *prev = _rel_get( &( s->prev ) );
+	shared_slab_t *next = _rel_get( &( s->next ) );
+
+	if( prev != NULL )
+		_rel_set( &( prev->next ), next );
+	else
+		_rel_set( chain, next );
+
+	if( next != NULL )
+		_rel_set( &( next->prev ), prev );
+
+	s->next = s->prev = 0;
+}
+
+static inline void _shared_refile( shared_slab_list_t *sl,
+	shared_slab_t *s,
+	unsigned int was_free,
+	unsigned int now_free
+) {
+	ptrdiff_t *from = _get_shared_chain( sl, was_free );
+	ptrdiff_t *to = _get_shared_chain( sl, now_free );
+
+	if( from != to ) {
+		_shared_unlink( from, s );
+		_shared_link( to, s );
+	}
+}
+
+static inline shared_slab_t *_get_carved_slab( shared_region_t *r,
+	uint64_t idx
+) {
+	return ( shared_slab_t* ) ( ( ( char* ) r ) + r->first + r->stride * idx );
+}
+
+// block maps are the source of truth; lists are derived from them
+static void _rebuild_lists( shared_region_t *r ) {
+	memset( &( r->slab_list ), 0, sizeof( shared_slab_list_t ) );
+
+	for( uint64_t cyc = 0; cyc < r->ncarved; ++cyc ) {
+		shared_slab_t *s = _get_carved_slab( r, cyc );
+		_shared_link(
+			_get_shared_chain( &( r->slab_list ),
+				_get_shared_free_slots( s )
+			),
+			s
+		);
+	}
+}
+
+static shared_region_t *_lock_region( shared_cache_t *c ) {
+	shared_region_t *r = c->region;
+	int rc = pthread_mutex_lock( &( r->protect ) );
+
+	if( rc == EOWNERDEAD ) {
+		// previous owner has died in the middle of critical section;
+		// lists might be inconsistent
+		_rebuild_lists( r );
+		pthread_mutex_consistent( &( r->protect ) );
+	} else if( rc )
+		return NULL;
+
+	return r;
+}
+
+static inline void _unlock_region( shared_region_t *r ) {
+	pthread_mutex_unlock( &( r->protect ) );
+}
+
+static void *_shared_object_alloc( cache_t *cache ) {
+	shared_region_t *r = _lock_region( ( shared_cache_t* ) cache );
+	if( r == NULL )
+		return NULL;
+
+	shared_slab_list_t *sl = &( r->slab_list );
+	shared_slab_t *s = NULL;
+	for( unsigned int cyc = 0; ( s == NULL ) && ( cyc < PARTIAL_BUCKETS_NUM );
+		++cyc
+	)
+		s = _rel_get( &( sl->partial_list[ cyc ] ) );
+
+	if( ( s == NULL ) && ( ( s = _rel_get( &( sl->free_list ) ) ) == NULL ) ) {
+		if( r->ncarved == r->nslabs ) {
+			_unlock_region( r );
+			return NULL;
+		}
+
+		// carve the next chunk; it's counted only after construction, so
+		// the chunk will be carved again if we die in the middle
+		s = _get_carved_slab( r, r->ncarved );
+		memset( s, 0, sizeof( shared_slab_t ) );
+		s->map = EMPTY_MAP;
+		// only slots are initialized; header isn't touched
+		_init_slots( cache, ( slab_t* ) s );
+		++( r->ncarved );
+
+		_shared_link( &( sl->free_list ), s );
+	}
+
+	unsigned int nfree = _get_shared_free_slots( s );
+	void *ret = _get_shared_block( cache, s );
+	_shared_refile( sl, s, nfree, nfree - 1 );
+
+	if( cache->options & SLAB_REFERABLE )
+		_reset_refcount( cache, ret );
+
+	_unlock_region( r );
+
+	return ret;
+}
+
+static void *_shared_object_get( cache_t *cache, void *obj ) {
+	if( cache->options & SLAB_REFERABLE ) {
+		shared_region_t *r = _lock_region( ( shared_cache_t* ) cache );
+		if( r == NULL )
+			return NULL;
+
+		_inc_refcount( cache, obj );
+		_unlock_region( r );
+	}
+
+	return obj;
+}
+
+static void *_shared_object_put( cache_t *cache, void *obj ) {
+	shared_region_t *r = _lock_region( ( shared_cache_t* ) cache );
+	if( r == NULL )
+		return NULL;
+
+	if( ( !( cache->options & SLAB_REFERABLE ) ) ||
+		( !_dec_refcount( cache, obj ) )
+	) {
+		if( cache->slab_class.reinit != NULL )
+			cache->slab_class.reinit( obj, cache->slab_class.ctag );
+
+		unsigned int pos = _get_slot_num( cache, obj );
+		shared_slab_t *s = ( shared_slab_t* ) _get_slab( cache, obj );
+		unsigned int nfree = _get_shared_free_slots( s );
+
+		s->map |= 1u << pos;
+		_shared_refile( &( r->slab_list ), s, nfree, nfree + 1 );
+
+		obj = NULL;
+	}
+
+	_unlock_region( r );
+
+	return obj;
+}
+
+static int _init_region_lock( shared_region_t *r ) {
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init( &attr );
+	pthread_mutexattr_setpshared( &attr, PTHREAD_PROCESS_SHARED );
+	pthread_mutexattr_setrobust( &attr, PTHREAD_MUTEX_ROBUST );
+	int rc = pthread_mutex_init( &( r->protect ), &attr );
+	pthread_mutexattr_destroy( &attr );
+
+	return rc ? -1 : 0;
+}
+
+static int _format_region( cache_t *cache, shared_region_t *r, size_t size ) {
+	size_t align = _get_slab_align( cache );
+	size_t first = _adjust_align( sizeof( shared_region_t ), align );
+	size_t stride = _adjust_align( _get_slab_size( cache ), align );
+
+	if( ( align > ( size_t ) sysconf( _SC_PAGESIZE ) ) ||
+		( first + stride > size )
+	)
+		return -1;
+
+	memset( r, 0, sizeof( shared_region_t ) );
+	r->version = SHARED_VERSION;
+	r->options = cache->options;
+	r->size = size;
+	r->obj_sz = cache->slab_class.blk_sz;
+	r->blk_sz = cache->blk_sz;
+	r->align = cache->align;
+	r->first = first;
+	r->stride = stride;
+	r->nslabs = ( size - first ) / stride;
+
+	if( _init_region_lock( r ) )
+		return -1;
+
+	// magic is written the last; half-formatted region will be formatted
+	// again by the next process
+	__sync_synchronize();
+	r->magic = SHARED_MAGIC;
+
+	return 0;
+}
+
+static int _check_region( cache_t *cache, shared_region_t *r, size_t size ) {
+	if( ( r->magic != SHARED_MAGIC ) ||
+		( r->version != SHARED_VERSION ) ||
+		( r->options != cache->options ) ||
+		( r->size != size ) ||
+		( r->obj_sz != cache->slab_class.blk_sz ) ||
+		( r->blk_sz != cache->blk_sz ) ||
+		( r->align != cache->align ) ||
+		( r->first != _adjust_align( sizeof( shared_region_t ),
+			_get_slab_align( cache ) )
+		)
+	)
+		return -1;
+
+	return 0;
+}
+
+// nobody else is attached to the region, so the state of mutex (and lists)
+// is whatever was left by the last process; it might have died with mutex
+// held or during system crash, so both of them are restored
+static int _recover_region( cache_t *cache, shared_region_t *r, size_t size ) {
+	if( _check_region( cache, r, size ) || _init_region_lock( r ) )
+		return -1;
+
+	_rebuild_lists( r );
+
+	return 0;
+}
+
+// each attached process holds shared lock on backing file while it's
+// attached; so the process which manages to get exclusive lock is the only
+// user of region and may format or recover it
+static shared_region_t *_map_region( cache_t *cache, int fd, size_t size ) {
+	struct stat st;
+	int sole = ( flock( fd, LOCK_EX | LOCK_NB ) == 0 );
+
+	if( ( ! sole ) && flock( fd, LOCK_SH ) )
+		return NULL;
+
+	shared_region_t *r = NULL;
+	if( ( fstat( fd, &st ) == 0 ) &&
+		( ( ( size_t ) st.st_size >= size ) ||
+			( sole && ( ftruncate( fd, size ) == 0 ) )
+		)
+	) {
+		r = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+		if( r == MAP_FAILED )
+			r = NULL;
+		else if( ( ! sole ) ?
+			_check_region( cache, r, size ) :
+			( ( r->magic == SHARED_MAGIC ) ?
+				_recover_region( cache, r, size ) :
+				_format_region( cache, r, size )
+			)
+		) {
+			munmap( r, size );
+			r = NULL;
+		}
+	}
+
+	if( r == NULL )
+		flock( fd, LOCK_UN );
+	else if( sole )
+		flock( fd, LOCK_SH );
+
+	return r;
+}
+
+cache_t *pool_shared_create( unsigned int options,
+	slab_class_t *slab_class,
+	int fd,
+	size_t size
+) {
+	assert( !( options & (
+		SLAB_HUGE_PAGES | SLAB_LIFO | SLAB_ZERO | SLAB_HANDLES | SLAB_HANDLE_GEN
+	) ) );
+	assert( fd >= 0 );
+
+	shared_cache_t *c = _bzero( sizeof( shared_cache_t ) );
+	_pool_init( c, slab_class, &_G_shared_cache, options, 0 );
+
+	// chunks are carved from region rather than taken from chunk source,
+	// so there is nothing refiller could build in advance
+	c->abstract_cache.slab_source.concurrent = 0;
+
+	// header of chunk in region is shared_slab_t
+	c->abstract_cache.header_sz = _adjust_align( sizeof( shared_slab_t ),
+		c->abstract_cache.align
+	);
+
+	if( ( c->region = _map_region( c, fd, size ) ) == NULL ) {
+		free( c );
+		return NULL;
+	}
+
+	c->fd = fd;
+
+	return c;
+}
+
+size_t pool_shared_offset( cache_t *cache, void *obj ) {
+	return ( ( char* ) obj ) -
+		( ( char* ) ( ( shared_cache_t* ) cache )->region );
+}
+
+void *pool_shared_object( cache_t *cache, size_t offset ) {
+	return ( ( char* ) ( ( shared_cache_t* ) cache )->region ) + offset;
+}
+
+void pool_shared_set_root( cache_t *cache, void *obj ) {
+	shared_region_t *r = _lock_region( ( shared_cache_t* ) cache );
+	if( r == NULL )
+		return;
+
+	r->root = ( obj == NULL ) ? 0 : pool_shared_offset( cache, obj );
+	_unlock_region( r );
+}
+
+void *pool_shared_get_root( cache_t *cache ) {
+	shared_region_t *r = _lock_region( ( shared_cache_t* ) cache );
+	if( r == NULL )
+		return NULL;
+
+	uint64_t root = r->root;
+	_unlock_region( r );
+
+	return ( root == 0 ) ? NULL : pool_shared_object( cache, root );
+}
+
+// chunks in region aren't linked with raw pointers, so there is no
+// process-local slab list
+static slab_list_t *_get_shared_slab_list( cache_t *c ) {
+	return NULL;
+}
+
+// region memory belongs to all attached processes
+static void _pool_shared_evict( cache_t *c ) { }
+
+static void _pool_shared_destroy( cache_t *c ) {
+	shared_cache_t *sc = ( shared_cache_t* ) c;
+	munmap( sc->region, sc->region->size );
+	flock( sc->fd, LOCK_UN );
+}
+
+static cache_class_t _G_shared_cache = {
+	.get_slab_list = _get_shared_slab_list,
+	.release_slab_list = NULL,
+	.pool_destroy = _pool_shared_destroy,
+	.pool_evict = _pool_shared_evict,
+	.object_alloc = _shared_object_alloc,
+	.object_get = _shared_object_get,
+	.object_put = _shared_object_put
+};
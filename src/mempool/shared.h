@@ -0,0 +1,80 @@
+#ifndef LIBMEMPOOL_SHARED_H
+#define LIBMEMPOOL_SHARED_H
+
+#include <mempool.h>
+
+/**
+ * Creates cache placed in shared memory region or attaches to existing one.
+ * All chunks of the cache live in the single region mapped from fd (memfd or
+ * regular file) with MAP_SHARED. Chunks are linked with self-relative offsets,
+ * so region can be mapped at different addresses by several processes
+ * simultaneously and survives process restarts when it's file-backed.
+ * Processes are synchronized with process-shared robust mutex placed in the
+ * region. If region isn't formatted yet then it will be formatted (file will
+ * be extended to size if needed); otherwise cache attaches to existing
+ * chunks and objects without running constructors again. Chunk lists are
+ * rebuilt from block maps by the first process attaching to the region and by
+ * the process which acquires the mutex after its owner has died. Attached
+ * process holds shared flock on fd, so fd must stay open until pool_free.
+ * Region has fixed capacity: allocation returns NULL when all chunks are
+ * used. Objects are constructed with ctor of the process which carves chunk
+ * from the region, so objects must not hold process-local pointers; use
+ * pool_shared_offset and pool_shared_object to refer to objects in region.
+ * Objects are never destructed: pool_free just unmaps region and pool_reap
+ * does nothing. SLAB_HUGE_PAGES, SLAB_LIFO, SLAB_ZERO and SLAB_HANDLES options
+ * aren't supported.
+ * @param options cache options
+ * @param slab_class SLAB object class; geometry must match the one region
+ * 			has been formatted with
+ * @param fd file descriptor of region backing file
+ * @param size region size in bytes
+ * @return !=NULL - it will be cache object; NULL - something went wrong (or
+ * 			region geometry doesn't match)
+ * @see pool_shared_offset
+ * @see pool_shared_object
+ * @see pool_shared_set_root
+ */
+extern cache_t *pool_shared_create( unsigned int options,
+	slab_class_t *slab_class,
+	int fd,
+	size_t size
+);
+
+/**
+ * Converts object address to region offset.
+ * Offset is valid in every process attached to the region.
+ * @param cache shared cache
+ * @param obj object allocated from the cache
+ * @return offset of the object
+ * @see pool_shared_object
+ */
+extern size_t pool_shared_offset( cache_t *cache, void *obj );
+
+/**
+ * Converts region offset to object address in calling process.
+ * @param cache shared cache
+ * @param offset offset obtained with pool_shared_offset
+ * @return object address
+ * @see pool_shared_offset
+ */
+extern void *pool_shared_object( cache_t *cache, size_t offset );
+
+/**
+ * Stores root object of the region.
+ * Root object is entry point for the data structure kept in region; it can be
+ * fetched after re-attaching with pool_shared_get_root.
+ * @param cache shared cache
+ * @param obj object allocated from the cache or NULL
+ * @see pool_shared_get_root
+ */
+extern void pool_shared_set_root( cache_t *cache, void *obj );
+
+/**
+ * Fetches root object of the region.
+ * @param cache shared cache
+ * @return root object or NULL if it hasn't been set
+ * @see pool_shared_set_root
+ */
+extern void *pool_shared_get_root( cache_t *cache );
+
+#endif
@@ -19,35 +19,25 @@ cache_t *pool_simple_create( unsigned int options,
 ) {
 	simple_cache_t *c = _bzero( sizeof( simple_cache_t ) );
 	_pool_init( c, slab_class, &_G_simple_cache, options, inum );
+	_prepopulate_list( c, &( c->slab_list.free_list ), NULL );
 	return c;
 }
 
 static slab_list_t *_get_simple_slab_list( cache_t *cache ) {
-	slab_list_t *sl = &( ( ( simple_cache_t* ) cache )->slab_list );
-	
-	if( sl->free_list == NULL )
-		_prepopulate_list( cache, &( sl->free_list ), NULL );
-	
-	return sl;
+	return &( ( ( simple_cache_t* ) cache )->slab_list );
 }
 
 static void _pool_simple_evict( cache_t *c ) {
-	_evict_slab_list( _get_simple_slab_list( cache ),
-		c->slab_class.dtor,
-		c->slab_class.ctag
-	);
+	_evict_slab_list( c, _get_simple_slab_list( c ) );
 }
 
 static void _pool_simple_destroy( cache_t *c ) {
-	_free_slab_list(
-		_get_simple_slab_list( c ),
-		c->slab_class.dtor,
-		c->slab_class.ctag
-	);
+	_free_slab_list( c, _get_simple_slab_list( c ) );
 }
 
 static cache_class_t _G_simple_cache = {
 	.get_slab_list = _get_simple_slab_list,
+	.release_slab_list = NULL,
 	.pool_destroy = _pool_simple_destroy,
 	.pool_evict = _pool_simple_evict
 };
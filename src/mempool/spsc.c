@@ -0,0 +1,214 @@
+#include <mempool/spsc.h>
+#include <mempool/common.h>
+
+#include <mempool.h>
+
+#include <pthread.h>
+#include <stdalign.h>
+#include <string.h>
+
+#define SPSC_DEFAULT_RING_SIZE 1024
+
+/**
+ * Single-producer/single-consumer cache.
+ * Allocating thread owns slab list; releasing thread owns head of the ring.
+ * Fields written by different threads are placed in different cache lines.
+ * @see pool_spsc_create
+ */
+typedef struct {
+	cache_t abstract_cache; /**< Cache header.*/
+	slab_list_t slab_list; /**< Slab list; allocating thread only.*/
+	void **ring; /**< Released objects on their way back.*/
+	size_t mask; /**< Ring size minus one.*/
+	size_t nallocs; /**< Allocations since last drain; allocating thread
+						only.*/
+	alignas( CACHE_LINE_SIZE ) size_t head; /**< Next ring slot to fill;
+												written by releasing
+												thread.*/
+	size_t tail_cache; /**< Last tail seen by releasing thread.*/
+	alignas( CACHE_LINE_SIZE ) size_t tail; /**< Next ring slot to drain;
+												written by allocating
+												thread.*/
+	alignas( CACHE_LINE_SIZE ) pthread_mutex_t overflow_protect; /**<
+										Guards overflow list.*/
+	void **overflow; /**< Objects which haven't fit into ring.*/
+	size_t noverflow; /**< Number of objects in overflow list.*/
+	size_t overflow_sz; /**< Capacity of overflow list.*/
+} spsc_cache_t;
+
+// ring is full; it's a rare case when allocating thread doesn't allocate
+// for a long time
+static void _push_overflow( spsc_cache_t *c, void *obj ) {
+	pthread_mutex_lock( &( c->overflow_protect ) );
+
+	if( c->noverflow == c->overflow_sz ) {
+		size_t sz = ( c->overflow_sz == 0 ) ? ( c->mask + 1 ) :
+			( c->overflow_sz * 2 );
+		void **o = realloc( c->overflow, sizeof( void* ) * sz );
+
+		// there is no way to report failure from put; object is
+		// lost for the cache but it's still valid memory
+		if( o == NULL ) {
+			pthread_mutex_unlock( &( c->overflow_protect ) );
+			return;
+		}
+
+		c->overflow = o;
+		c->overflow_sz = sz;
+	}
+
+	c->overflow[ c->noverflow ] = obj;
+	__atomic_store_n( &( c->noverflow ), c->noverflow + 1, __ATOMIC_RELAXED );
+
+	pthread_mutex_unlock( &( c->overflow_protect ) );
+}
+
+static void _push_released( spsc_cache_t *c, void *obj ) {
+	size_t h = c->head;
+
+	// tail is re-read only when ring looks full according to cached value
+	if( ( h - c->tail_cache ) > c->mask ) {
+		c->tail_cache = __atomic_load_n( &( c->tail ), __ATOMIC_ACQUIRE );
+
+		if( ( h - c->tail_cache ) > c->mask ) {
+			_push_overflow( c, obj );
+			return;
+		}
+	}
+
+	c->ring[ h & c->mask ] = obj;
+	__atomic_store_n( &( c->head ), h + 1, __ATOMIC_RELEASE );
+}
+
+// takes all released objects back; called by allocating thread
+static void _drain_released( spsc_cache_t *c ) {
+	cache_t *cache = &( c->abstract_cache );
+	size_t t = c->tail;
+	size_t h = __atomic_load_n( &( c->head ), __ATOMIC_ACQUIRE );
+
+	for( ; t != h; ++t )
+		_release_block( cache, &( c->slab_list ), c->ring[ t & c->mask ] );
+
+	__atomic_store_n( &( c->tail ), t, __ATOMIC_RELEASE );
+
+	if( __atomic_load_n( &( c->noverflow ), __ATOMIC_RELAXED ) ) {
+		pthread_mutex_lock( &( c->overflow_protect ) );
+
+		for( size_t cyc = 0; cyc < c->noverflow; ++cyc )
+			_release_block( cache, &( c->slab_list ), c->overflow[ cyc ] );
+
+		__atomic_store_n( &( c->noverflow ), 0, __ATOMIC_RELAXED );
+
+		pthread_mutex_unlock( &( c->overflow_protect ) );
+	}
+
+	c->nallocs = 0;
+}
+
+static void *_spsc_object_alloc( cache_t *cache ) {
+	spsc_cache_t *c = ( spsc_cache_t* ) cache;
+
+	// released objects are taken back in batch before we run into free
+	// (or new) chunk; ring is also drained each half of its size
+	// allocations, so it doesn't overflow while partial chunks last
+	if( ( _get_fullest_slab( &( c->slab_list ) ) == NULL ) ||
+		( ( ++( c->nallocs ) ) > ( c->mask >> 1 ) )
+	)
+		_drain_released( c );
+
+	return _alloc_block( cache, &( c->slab_list ) );
+}
+
+static void *_spsc_object_get( cache_t *cache, void *obj ) {
+	if( cache->options & SLAB_REFERABLE )
+		_inc_refcount( cache, obj );
+
+	return obj;
+}
+
+// object is recycled by releasing thread while it's still warm in its
+// CPU cache
+static void *_spsc_object_put( cache_t *cache, void *obj ) {
+	if( ( cache->options & SLAB_REFERABLE ) && _dec_refcount( cache, obj ) )
+		return obj;
+
+	if( cache->slab_class.reinit != NULL )
+		cache->slab_class.reinit( obj, cache->slab_class.ctag );
+
+	_expire_handle( cache, obj );
+	_push_released( ( spsc_cache_t* ) cache, obj );
+
+	return NULL;
+}
+
+cache_t *pool_spsc_create( unsigned int options,
+	slab_class_t *slab_class,
+	unsigned int inum,
+	unsigned int ring_size
+) {
+	size_t sz = 1;
+	while( sz < ( ( ring_size == 0 ) ? SPSC_DEFAULT_RING_SIZE : ring_size ) )
+		sz <<= 1;
+
+	spsc_cache_t *c = NULL;
+	if( posix_memalign( ( void** ) &c,
+			CACHE_LINE_SIZE,
+			sizeof( spsc_cache_t )
+		)
+	)
+		return NULL;
+
+	memset( c, 0, sizeof( spsc_cache_t ) );
+	if( ( c->ring = malloc( sizeof( void* ) * sz ) ) == NULL ) {
+		free( c );
+		return NULL;
+	}
+
+	c->mask = sz - 1;
+	pthread_mutex_init( &( c->overflow_protect ), NULL );
+	_pool_init( &( c->abstract_cache ),
+		slab_class,
+		&_G_spsc_cache,
+		options,
+		inum
+	);
+	_prepopulate_list( &( c->abstract_cache ),
+		&( c->slab_list.free_list ),
+		NULL
+	);
+
+	return &( c->abstract_cache );
+}
+
+// used by generic routines; chunks belong to allocating thread, so
+// released objects are taken back first
+static slab_list_t *_get_spsc_slab_list( cache_t *cache ) {
+	spsc_cache_t *c = ( spsc_cache_t* ) cache;
+
+	_drain_released( c );
+
+	return &( c->slab_list );
+}
+
+static void _pool_spsc_evict( cache_t *cache ) {
+	_evict_slab_list( cache, _get_spsc_slab_list( cache ) );
+}
+
+static void _pool_spsc_destroy( cache_t *cache ) {
+	spsc_cache_t *c = ( spsc_cache_t* ) cache;
+
+	_free_slab_list( cache, &( c->slab_list ) );
+	pthread_mutex_destroy( &( c->overflow_protect ) );
+	free( c->overflow );
+	free( c->ring );
+}
+
+static cache_class_t _G_spsc_cache = {
+	.get_slab_list = _get_spsc_slab_list,
+	.release_slab_list = NULL,
+	.pool_destroy = _pool_spsc_destroy,
+	.pool_evict = _pool_spsc_evict,
+	.object_alloc = _spsc_object_alloc,
+	.object_get = _spsc_object_get,
+	.object_put = _spsc_object_put
+};
@@ -0,0 +1,36 @@
+#ifndef LIBMEMPOOL_SPSC_H
+#define LIBMEMPOOL_SPSC_H
+
+#include <mempool.h>
+
+/**
+ * Creates single-producer/single-consumer cache.
+ * Cache is tuned for pipeline handoff: objects are allocated by the single
+ * thread and released by another single thread. Allocating thread owns all
+ * chunks and works with them without synchronization. Releasing thread
+ * recycles object (with reinit) and passes it back through wait-free ring;
+ * allocating thread takes released objects back in batches when it runs out
+ * of partially filled chunks and periodically. So in steady state there are
+ * neither locks nor contended read-modify-write atomics. If ring is full then
+ * object is passed through mutex-protected overflow list. pool_object_alloc,
+ * pool_reap, pool_compact and other routines working with chunks should be
+ * called by allocating thread only; pool_object_get and pool_object_put
+ * should be called by releasing thread only (object is owned by releasing
+ * thread after handoff).
+ * @param options cache options
+ * @param slab_class SLAB object class
+ * @param inum number of blocks will be reserved for immediate use
+ * @param ring_size ring capacity in objects (rounded up to power of 2); 0
+ * 			means default one
+ * @return !=NULL - it will be cache object; NULL - something went wrong
+ * @see pool_free
+ * @see cache_t
+ * @see slab_class_t
+ */
+extern cache_t *pool_spsc_create( unsigned int options,
+	slab_class_t *slab_class,
+	unsigned int inum,
+	unsigned int ring_size
+);
+
+#endif
@@ -0,0 +1,243 @@
+#include <mempool/striped.h>
+#include <mempool/common.h>
+
+#include <mempool.h>
+
+#include <pthread.h>
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Stripe of striped cache.
+ * Stripes are aligned to cache line to avoid false sharing of mutexes.
+ * @see striped_cache_t
+ */
+typedef struct {
+	alignas( CACHE_LINE_SIZE ) pthread_mutex_t protect; /**< Stripe lock.*/
+	slab_list_t slab_list; /**< Slab list.*/
+} stripe_t;
+
+/**
+ * Striped cache.
+ * Cache which spreads lock contention over several independent slab lists.
+ * @see cache_t
+ * @see stripe_t
+ * @see pool_striped_create
+ */
+typedef struct {
+	cache_t abstract_cache; /**< Cache header.*/
+	unsigned int nstripes; /**< Number of stripes.*/
+	stripe_t *stripes; /**< Stripes.*/
+} striped_cache_t;
+
+static inline stripe_t *_get_stripe_of( slab_list_t *sl ) {
+	return ( stripe_t* ) ( ( ( char* ) sl ) - offsetof( stripe_t, slab_list ) );
+}
+
+static inline unsigned int _get_home_stripe( striped_cache_t *c ) {
+	// Fibonacci hashing of thread identifier; low bits of pthread_t are
+	// usually the same because of stack alignment
+	uint64_t h = ( ( uint64_t ) pthread_self() ) * 0x9e3779b97f4a7c15ull;
+	return ( unsigned int ) ( ( h >> 32 ) % c->nstripes );
+}
+
+static stripe_t *_lock_stripe( striped_cache_t *c, unsigned int idx ) {
+	stripe_t *st = &( c->stripes[ idx ] );
+	int rc = _lock_mutex( &( st->protect ), &( c->abstract_cache ), NULL );
+
+	return rc ? NULL : st;
+}
+
+// home stripe goes first; if it's busy then we look for any free stripe
+// and wait for the home one only if all of them are busy
+static stripe_t *_acquire_stripe( striped_cache_t *c, unsigned int *idx ) {
+	unsigned int home = _get_home_stripe( c );
+
+	for( unsigned int cyc = 0; cyc < c->nstripes; ++cyc ) {
+		unsigned int cur = ( home + cyc ) % c->nstripes;
+
+		if( pthread_mutex_trylock( &( c->stripes[ cur ].protect ) ) == 0 ) {
+			*idx = cur;
+			return &( c->stripes[ cur ] );
+		}
+	}
+
+	*idx = home;
+	return _lock_stripe( c, home );
+}
+
+static inline void _release_stripe( stripe_t *st ) {
+	pthread_mutex_unlock( &( st->protect ) );
+}
+
+// chunks are stamped with stripe index once, when they join the stripe;
+// so new chunks are added here rather than by _alloc_block; returns 0 if
+// stripe has no room and no chunk can be added
+static int _stock_stripe( cache_t *cache, stripe_t *st, unsigned int idx ) {
+	slab_list_t *sl = &( st->slab_list );
+	if( ( sl->free_list != NULL ) || ( _get_fullest_slab( sl ) != NULL ) )
+		return 1;
+
+	if( ! _take_reserve( cache, sl ) ) {
+		slab_t *news = _alloc_slab( cache );
+		if( news == NULL )
+			return 0;
+
+		_link_slab( &( sl->free_list ), news );
+	}
+
+	for( slab_t *s = sl->free_list; s != NULL; s = s->next )
+		s->owner = idx;
+
+	return 1;
+}
+
+static void *_striped_object_alloc( cache_t *cache ) {
+	unsigned int idx = 0;
+	stripe_t *st = _acquire_stripe( ( striped_cache_t* ) cache, &idx );
+	if( st == NULL )
+		return NULL;
+
+	void *ret = _stock_stripe( cache, st, idx ) ?
+		_alloc_block( cache, &( st->slab_list ) ) :
+		NULL;
+
+	_release_stripe( st );
+
+	return ret;
+}
+
+static void *_striped_object_get( cache_t *cache, void *obj ) {
+	if( cache->options & SLAB_REFERABLE ) {
+		stripe_t *st = _lock_stripe( ( striped_cache_t* ) cache,
+			_get_slab( cache, obj )->owner
+		);
+
+		if( st == NULL )
+			return NULL;
+
+		_inc_refcount( cache, obj );
+		_release_stripe( st );
+	}
+
+	return obj;
+}
+
+static void *_striped_object_put( cache_t *cache, void *obj ) {
+	stripe_t *st = _lock_stripe( ( striped_cache_t* ) cache,
+		_get_slab( cache, obj )->owner
+	);
+
+	if( st == NULL )
+		return NULL;
+
+	obj = _put_block( cache, &( st->slab_list ), obj );
+	_release_stripe( st );
+
+	return obj;
+}
+
+cache_t *pool_striped_create( unsigned int options,
+	slab_class_t *slab_class,
+	unsigned int inum,
+	unsigned int nstripes
+) {
+	if( nstripes == 0 ) {
+		long ncpus = sysconf( _SC_NPROCESSORS_ONLN );
+		nstripes = ( ncpus > 0 ) ? ( unsigned int ) ncpus : 1;
+	}
+
+	striped_cache_t *c = _bzero( sizeof( striped_cache_t ) );
+	if( posix_memalign( ( void** ) &( c->stripes ),
+			CACHE_LINE_SIZE,
+			sizeof( stripe_t ) * nstripes
+		)
+	) {
+		free( c );
+		return NULL;
+	}
+
+	memset( c->stripes, 0, sizeof( stripe_t ) * nstripes );
+	c->nstripes = nstripes;
+	_pool_init( c, slab_class, &_G_striped_cache, options, inum / nstripes );
+
+	for( unsigned int cyc = 0; cyc < nstripes; ++cyc ) {
+		slab_list_t *sl = &( c->stripes[ cyc ].slab_list );
+
+		pthread_mutex_init( &( c->stripes[ cyc ].protect ), NULL );
+		_prepopulate_list( c, &( sl->free_list ), NULL );
+		for( slab_t *s = sl->free_list; s != NULL; s = s->next )
+			s->owner = cyc;
+	}
+
+	return c;
+}
+
+// generic routines which work with all slab lists use
+// _get_striped_slab_list_at; stripe of calling thread is exposed to the rest
+static slab_list_t *_get_striped_slab_list( cache_t *cache ) {
+	striped_cache_t *c = ( striped_cache_t* ) cache;
+	stripe_t *st = _lock_stripe( c, _get_home_stripe( c ) );
+
+	return ( st == NULL ) ? NULL : &( st->slab_list );
+}
+
+// used by iteration, compaction, reset and checkpoints
+static slab_list_t *_get_striped_slab_list_at( cache_t *cache,
+	unsigned int idx
+) {
+	striped_cache_t *c = ( striped_cache_t* ) cache;
+	if( idx >= c->nstripes )
+		return NULL;
+
+	stripe_t *st = _lock_stripe( c, idx );
+
+	return ( st == NULL ) ? NULL : &( st->slab_list );
+}
+
+static void _release_striped_slab_list( cache_t *cache, slab_list_t *sl ) {
+	_release_stripe( _get_stripe_of( sl ) );
+}
+
+static void _pool_striped_evict( cache_t *cache ) {
+	striped_cache_t *c = ( striped_cache_t* ) cache;
+
+	for( unsigned int cyc = 0; cyc < c->nstripes; ++cyc ) {
+		stripe_t *st = _lock_stripe( c, cyc );
+		if( st == NULL )
+			continue;
+
+		_evict_slab_list( cache, &( st->slab_list ) );
+		_release_stripe( st );
+	}
+}
+
+static void _pool_striped_destroy( cache_t *cache ) {
+	striped_cache_t *c = ( striped_cache_t* ) cache;
+
+	for( unsigned int cyc = 0; cyc < c->nstripes; ++cyc ) {
+		stripe_t *st = _lock_stripe( c, cyc );
+		if( st == NULL )
+			continue;
+
+		_free_slab_list( cache, &( st->slab_list ) );
+		_release_stripe( st );
+		pthread_mutex_destroy( &( st->protect ) );
+	}
+
+	free( c->stripes );
+}
+
+static cache_class_t _G_striped_cache = {
+	.get_slab_list = _get_striped_slab_list,
+	.release_slab_list = _release_striped_slab_list,
+	.pool_destroy = _pool_striped_destroy,
+	.pool_evict = _pool_striped_evict,
+	.object_alloc = _striped_object_alloc,
+	.object_get = _striped_object_get,
+	.object_put = _striped_object_put,
+	.get_slab_list_at = _get_striped_slab_list_at
+};
@@ -0,0 +1,32 @@
+#ifndef LIBMEMPOOL_STRIPED_H
+#define LIBMEMPOOL_STRIPED_H
+
+#include <mempool.h>
+
+/**
+ * Creates striped cache.
+ * Striped cache consists of nstripes independent slab lists each one
+ * protected by its own mutex. Allocating thread picks stripe by hash of
+ * thread identifier; if the stripe is locked then other stripes are tried
+ * without blocking and only if all of them are busy the thread waits for
+ * its own one. Object is always returned to the stripe its chunk belongs
+ * to (stripe index is recorded in chunk header). Contrary to per-thread
+ * caches, memory overhead is bounded by number of stripes. inum blocks are
+ * spread evenly over stripes. pool_compact, pool_reset and checkpoints work
+ * on all stripes, each one is locked in turn.
+ * @param options cache options
+ * @param slab_class SLAB object class
+ * @param inum number of blocks will be reserved for immediate use
+ * @param nstripes number of stripes; 0 means number of online CPUs
+ * @return !=NULL - it will be cache object; NULL - something went wrong
+ * @see pool_free
+ * @see cache_t
+ * @see slab_class_t
+ */
+extern cache_t *pool_striped_create( unsigned int options,
+	slab_class_t *slab_class,
+	unsigned int inum,
+	unsigned int nstripes
+);
+
+#endif
@@ -0,0 +1,204 @@
+#include <mempool/trace.h>
+#include <mempool/common.h>
+
+#include <mempool.h>
+
+#if LIBMEMPOOL_TRACE
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Ring buffer of the thread.
+ * @see pool_trace_header_t
+ */
+typedef struct {
+	pool_trace_header_t *header; /**< Mapped file.*/
+	pool_trace_event_t *events; /**< Ring itself; follows header.*/
+	size_t length; /**< Mapping length.*/
+	unsigned int generation; /**< Recording session ring belongs to.*/
+	uint32_t thread; /**< Thread id.*/
+} trace_ring_t;
+
+static char _G_trace_dir[ PATH_MAX ];
+static size_t _G_trace_capacity = 0;
+// odd generation means that recording is on; every pool_trace_start begins
+// new session, so rings of previous one are reopened
+static unsigned int _G_trace_generation = 0;
+static pthread_mutex_t _G_trace_protect = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t _G_trace_once = PTHREAD_ONCE_INIT;
+static pthread_key_t _G_trace_key;
+static __thread trace_ring_t *_T_ring = NULL;
+
+static void _close_ring( trace_ring_t *r ) {
+	munmap( r->header, r->length );
+	free( r );
+}
+
+static void _ring_destructor( void *r ) {
+	_close_ring( r );
+}
+
+static void _init_key( void ) {
+	pthread_key_create( &_G_trace_key, _ring_destructor );
+}
+
+static trace_ring_t *_open_ring( unsigned int generation ) {
+	char path[ PATH_MAX ];
+	uint32_t tid = ( uint32_t ) syscall( SYS_gettid );
+
+	pthread_mutex_lock( &_G_trace_protect );
+	size_t capacity = _G_trace_capacity;
+	int n = snprintf( path,
+		sizeof( path ),
+		"%s/mempool.%d.%u.trace",
+		_G_trace_dir,
+		( int ) getpid(),
+		tid
+	);
+	pthread_mutex_unlock( &_G_trace_protect );
+
+	if( ( n < 0 ) || ( ( size_t ) n >= sizeof( path ) ) )
+		return NULL;
+
+	trace_ring_t *r = malloc( sizeof( trace_ring_t ) );
+	if( r == NULL )
+		return NULL;
+
+	r->length = sizeof( pool_trace_header_t ) +
+		capacity * sizeof( pool_trace_event_t );
+	r->generation = generation;
+	r->thread = tid;
+
+	int fd = open( path, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+	if( fd < 0 ) {
+		free( r );
+		return NULL;
+	}
+
+	if( ftruncate( fd, r->length ) ) {
+		close( fd );
+		free( r );
+		return NULL;
+	}
+
+	void *p = mmap( NULL,
+		r->length,
+		PROT_READ | PROT_WRITE,
+		MAP_SHARED,
+		fd,
+		0
+	);
+	close( fd );
+
+	if( p == MAP_FAILED ) {
+		free( r );
+		return NULL;
+	}
+
+	r->header = p;
+	r->events = ( pool_trace_event_t* ) ( r->header + 1 );
+	r->header->magic = POOL_TRACE_MAGIC;
+	r->header->capacity = capacity;
+	r->header->written = 0;
+
+	return r;
+}
+
+void _pool_trace_record( enum pool_trace_type type,
+	cache_t *cache,
+	void *obj,
+	size_t size
+) {
+	unsigned int generation = __atomic_load_n( &_G_trace_generation,
+		__ATOMIC_ACQUIRE
+	);
+	trace_ring_t *r = _T_ring;
+
+	if( ( r != NULL ) && ( r->generation != generation ) ) {
+		pthread_setspecific( _G_trace_key, NULL );
+		_close_ring( r );
+		_T_ring = r = NULL;
+	}
+
+	if( !( generation & 1 ) )
+		return;
+
+	if( r == NULL ) {
+		if( ( r = _open_ring( generation ) ) == NULL )
+			return;
+
+		_T_ring = r;
+		pthread_setspecific( _G_trace_key, r );
+	}
+
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	uint64_t n = r->header->written;
+	pool_trace_event_t *e = r->events + ( n % r->header->capacity );
+	e->ts = ( ( uint64_t ) ts.tv_sec ) * 1000000000ull + ts.tv_nsec;
+	e->cache = ( uintptr_t ) cache;
+	e->obj = ( uintptr_t ) obj;
+	e->thread = r->thread;
+	e->type = type;
+	e->size = ( size < ( 1u << 24 ) ) ? size : ( ( 1u << 24 ) - 1 );
+
+	// counter is published after event, so reader of live file never sees
+	// event slot which isn't filled yet
+	__atomic_store_n( &( r->header->written ), n + 1, __ATOMIC_RELEASE );
+}
+
+int pool_trace_start( const char *dir, size_t capacity ) {
+	assert( dir != NULL );
+	assert( capacity > 0 );
+
+	if( strlen( dir ) >= sizeof( _G_trace_dir ) )
+		return -1;
+
+	pthread_once( &_G_trace_once, _init_key );
+
+	pthread_mutex_lock( &_G_trace_protect );
+	strcpy( _G_trace_dir, dir );
+	_G_trace_capacity = capacity;
+	if( !( _G_trace_generation & 1 ) )
+		__atomic_add_fetch( &_G_trace_generation, 1, __ATOMIC_RELEASE );
+	else
+		// restart: rings of running session should be reopened
+		__atomic_add_fetch( &_G_trace_generation, 2, __ATOMIC_RELEASE );
+	pthread_mutex_unlock( &_G_trace_protect );
+
+	return 0;
+}
+
+void pool_trace_stop( void ) {
+	pthread_mutex_lock( &_G_trace_protect );
+	if( _G_trace_generation & 1 )
+		__atomic_add_fetch( &_G_trace_generation, 1, __ATOMIC_RELEASE );
+	pthread_mutex_unlock( &_G_trace_protect );
+
+	// ring of calling thread is closed right now
+	if( _T_ring != NULL ) {
+		pthread_setspecific( _G_trace_key, NULL );
+		_close_ring( _T_ring );
+		_T_ring = NULL;
+	}
+}
+
+#else
+
+int pool_trace_start( const char *dir, size_t capacity ) {
+	return -1;
+}
+
+void pool_trace_stop( void ) {
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef LIBMEMPOOL_TRACE_H
+#define LIBMEMPOOL_TRACE_H
+
+#include <mempool.h>
+
+#include <stdint.h>
+
+/**
+ * Trace file signature.
+ * @see pool_trace_header_t
+ */
+#define POOL_TRACE_MAGIC 0x3145434152544d50ull
+
+/**
+ * Trace file header.
+ * Each thread records events into its own file named
+ * mempool.<pid>.<tid>.trace in directory given to pool_trace_start. File
+ * consists of the header followed by ring of capacity events. When ring is
+ * full, the oldest events are overwritten; so the file holds the last
+ * min( written, capacity ) events starting from slot written % capacity.
+ * @see pool_trace_event_t
+ */
+typedef struct {
+	uint64_t magic; /**< POOL_TRACE_MAGIC.*/
+	uint64_t capacity; /**< Number of event slots in ring.*/
+	uint64_t written; /**< Number of events recorded so far.*/
+	uint64_t reserved; /**< Keeps events 32-byte aligned.*/
+} pool_trace_header_t;
+
+/**
+ * Trace event.
+ * Cache and object are identified with their addresses in recording
+ * process. Object size is recorded for POOL_TRACE_ALLOC events only; it
+ * lets replay tool create cache of the same geometry.
+ * @see pool_trace_header_t
+ */
+typedef struct {
+	uint64_t ts; /**< Timestamp in nanoseconds (CLOCK_MONOTONIC).*/
+	uint64_t cache; /**< Cache id.*/
+	uint64_t obj; /**< Object id; 0 for POOL_TRACE_REAP.*/
+	uint32_t thread; /**< Thread id.*/
+	uint32_t type : 8; /**< Event type (pool_trace_type).*/
+	uint32_t size : 24; /**< Object size (slab_class_t::blk_sz).*/
+} pool_trace_event_t;
+
+/**
+ * Starts recording of allocation trace.
+ * Recording is available only if library is built with TRACE option. Each
+ * thread creates its ring buffer file on its first traced operation. Files are
+ * mapped to memory, so recording of event doesn't involve system calls.
+ * @param dir directory where files will be placed
+ * @param capacity ring size in events per thread
+ * @return 0 - success; -1 - recording isn't available
+ * @see pool_trace_stop
+ */
+extern int pool_trace_start( const char *dir, size_t capacity );
+
+/**
+ * Stops recording of allocation trace.
+ * Ring buffer files of other threads are closed on their next traced
+ * operation or exit.
+ * @see pool_trace_start
+ */
+extern void pool_trace_stop( void );
+
+#endif
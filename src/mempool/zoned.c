@@ -30,12 +30,14 @@ cache_t *pool_zone_create( unsigned int options,
 
 typedef struct {
 	slab_list_t slab_list;
-	void ( *dtor )( void *obj, void *ctag );
-	void *ctag
+	cache_t *cache;
 } zoned_slab_list_t;
 
+// zone holds the cache, so chunk source is still there even if pool_free
+// has been called before the thread exits
 static void _free_zone( zoned_slab_list_t *z ) {
-	_free_slab_list( &( z->slab_list ), z->dtor, z->ctag );
+	_free_slab_list( z->cache, &( z->slab_list ) );
+	_pool_unref( z->cache );
 	free( z );
 }
 
@@ -46,28 +48,27 @@ static slab_list_t *_get_zoned_slab_list( cache_t *c ) {
 	if( lsl == NULL ) {
 		lsl = malloc( sizeof( zoned_slab_list_t ) );
 		memset( &( lsl->slab_list ), 0, sizeof( slab_list_t ) );
-		lsl->dtor = c->slab_class.dtor;
-		lsl->ctag = c->slab_class.ctag;
+		lsl->cache = c;
+		__atomic_add_fetch( &( c->refs ), 1, __ATOMIC_RELAXED );
+		_prepopulate_list( c, &( lsl->slab_list.free_list ), NULL );
 		pthread_setspecific( key, lsl );
 	}
 
-	if( lsl->slab_list.free_list == NULL )
-		_prepopulate_list( cache, &( lsl->slab_list.free_list ), NULL );
-
 	return &( lsl->slab_list );
 }
 
-static void _pool_zoned_destroy( cache_t *c ) { }
+// all zones are gone by now
+static void _pool_zoned_destroy( cache_t *c ) {
+	pthread_key_delete( ( ( zoned_cache_t* ) c )->thread_local );
+}
 
 static void _pool_zoned_evict( cache_t *c ) {
-	_evict_slab_list( _get_zoned_slab_list( c ),
-		c->slab_class.dtor,
-		c->slab_class.ctag
-	);
+	_evict_slab_list( c, _get_zoned_slab_list( c ) );
 }
 
 static cache_class_t _G_zoned_cache = {
 	.get_slab_list = _get_zoned_slab_list,
+	.release_slab_list = NULL,
 	.pool_destroy = _pool_zoned_destroy,
 	.pool_evict = _pool_zoned_evict
 };
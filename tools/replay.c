@@ -0,0 +1,370 @@
+#define _GNU_SOURCE
+
+#include <mempool.h>
+#include <mempool/simple.h>
+#include <mempool/lockable.h>
+#include <mempool/zoned.h>
+#include <mempool/striped.h>
+#include <mempool/trace.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Replays allocation trace recorded with pool_trace_start against chosen
+// cache class and options (memory backend is the one library is built with).
+// Events of all thread files are merged by timestamp and replayed by single
+// thread, so numbers reflect allocator work rather than recorded
+// concurrency. Objects which were allocated before recording started (or
+// whose allocation has been overwritten in ring) are skipped. Memory
+// footprint is growth of resident set over the replay: it's sampled after
+// the trace and the object table are in memory, so their size doesn't count.
+//
+// usage: replay [-c simple|lockable|zoned|striped] [-n inum] [-H] [-L] [-Z]
+//        file...
+
+#define LATENCY_BUCKETS 64
+
+// resident set is sampled so many operations apart
+#define RSS_SAMPLE_OPS 4096
+
+typedef struct {
+	uint64_t id; /**< Cache id in trace.*/
+	cache_t *cache; /**< Cache created for replay.*/
+	slab_class_t sclass; /**< Its object class.*/
+	int referable; /**< Whether trace has pool_object_get on it.*/
+} replay_cache_t;
+
+typedef struct {
+	uint64_t cache; /**< 0 - empty slot; UINT64_MAX - deleted one.*/
+	uint64_t obj;
+	void *ptr; /**< Replayed object.*/
+} object_slot_t;
+
+static pool_trace_event_t *_G_events = NULL;
+static size_t _G_nevents = 0;
+
+static replay_cache_t *_G_caches = NULL;
+static size_t _G_ncaches = 0;
+
+static object_slot_t *_G_objects = NULL;
+static size_t _G_mask = 0;
+
+static int _load( const char *path ) {
+	FILE *f = fopen( path, "rb" );
+	if( f == NULL )
+		return -1;
+
+	pool_trace_header_t h;
+	if( ( fread( &h, sizeof( h ), 1, f ) != 1 ) ||
+		( h.magic != POOL_TRACE_MAGIC ) ||
+		( h.capacity == 0 )
+	) {
+		fclose( f );
+		return -1;
+	}
+
+	pool_trace_event_t *ring = malloc( sizeof( pool_trace_event_t ) *
+		h.capacity
+	);
+	if( ( ring == NULL ) ||
+		( fread( ring, sizeof( pool_trace_event_t ), h.capacity, f ) !=
+			h.capacity )
+	) {
+		free( ring );
+		fclose( f );
+		return -1;
+	}
+
+	fclose( f );
+
+	// the oldest event follows the newest one if ring has wrapped
+	size_t n = ( h.written < h.capacity ) ? h.written : h.capacity;
+	size_t first = ( h.written < h.capacity ) ? 0 : h.written % h.capacity;
+
+	_G_events = realloc( _G_events,
+		sizeof( pool_trace_event_t ) * ( _G_nevents + n )
+	);
+	if( _G_events == NULL ) {
+		free( ring );
+		return -1;
+	}
+
+	for( size_t cyc = 0; cyc < n; ++cyc )
+		_G_events[ _G_nevents++ ] = ring[ ( first + cyc ) % h.capacity ];
+
+	free( ring );
+	return 0;
+}
+
+static int _compare_events( const void *a, const void *b ) {
+	const pool_trace_event_t *ea = a, *eb = b;
+	return ( ea->ts > eb->ts ) - ( ea->ts < eb->ts );
+}
+
+static replay_cache_t *_find_cache( uint64_t id ) {
+	for( size_t cyc = 0; cyc < _G_ncaches; ++cyc )
+		if( _G_caches[ cyc ].id == id )
+			return _G_caches + cyc;
+
+	return NULL;
+}
+
+// caches are described by the trace itself: object size comes with
+// allocation events, referability is deduced from presence of get events
+static void _collect_caches( void ) {
+	_G_caches = calloc( _G_nevents + 1, sizeof( replay_cache_t ) );
+
+	for( size_t cyc = 0; cyc < _G_nevents; ++cyc ) {
+		pool_trace_event_t *e = _G_events + cyc;
+		replay_cache_t *c = _find_cache( e->cache );
+
+		if( c == NULL ) {
+			c = _G_caches + ( _G_ncaches++ );
+			c->id = e->cache;
+		}
+
+		if( ( e->type == POOL_TRACE_ALLOC ) && ( c->sclass.blk_sz == 0 ) )
+			c->sclass.blk_sz = e->size;
+
+		if( e->type == POOL_TRACE_GET )
+			c->referable = 1;
+	}
+}
+
+static cache_t *_create( const char *cclass,
+	unsigned int options,
+	slab_class_t *sclass,
+	unsigned int inum
+) {
+	if( ! strcmp( cclass, "simple" ) )
+		return pool_simple_create( options, sclass, inum );
+
+	if( ! strcmp( cclass, "lockable" ) )
+		return pool_lockable_create( options, sclass, inum );
+
+	if( ! strcmp( cclass, "zoned" ) )
+		return pool_zone_create( options, sclass, inum );
+
+	if( ! strcmp( cclass, "striped" ) )
+		return pool_striped_create( options, sclass, inum, 0 );
+
+	return NULL;
+}
+
+static inline size_t _hash( uint64_t cache, uint64_t obj ) {
+	return ( size_t ) ( ( ( obj >> 3 ) ^ cache ) * 0x9e3779b97f4a7c15ull );
+}
+
+static object_slot_t *_lookup( uint64_t cache, uint64_t obj, int insert ) {
+	object_slot_t *deleted = NULL;
+
+	for( size_t idx = _hash( cache, obj ) & _G_mask; ;
+		idx = ( idx + 1 ) & _G_mask
+	) {
+		object_slot_t *s = _G_objects + idx;
+
+		if( s->cache == 0 )
+			return insert ? ( ( deleted != NULL ) ? deleted : s ) : NULL;
+
+		if( s->cache == UINT64_MAX ) {
+			if( deleted == NULL )
+				deleted = s;
+		} else if( ( s->cache == cache ) && ( s->obj == obj ) )
+			return s;
+	}
+}
+
+// current resident set size in kB; 0 if it's unknown
+static size_t _get_rss( void ) {
+	FILE *f = fopen( "/proc/self/statm", "r" );
+	if( f == NULL )
+		return 0;
+
+	unsigned long size = 0, resident = 0;
+	int n = fscanf( f, "%lu %lu", &size, &resident );
+	fclose( f );
+
+	return ( n == 2 ) ?
+		( resident * ( size_t ) sysconf( _SC_PAGESIZE ) ) >> 10 : 0;
+}
+
+static inline uint64_t _now( void ) {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ( ( uint64_t ) ts.tv_sec ) * 1000000000ull + ts.tv_nsec;
+}
+
+static uint64_t _percentile( unsigned long long *hist,
+	unsigned long long total,
+	double p
+) {
+	unsigned long long seen = 0;
+
+	for( unsigned int cyc = 0; cyc < LATENCY_BUCKETS; ++cyc )
+		if( ( seen += hist[ cyc ] ) >= total * p )
+			return 1ull << cyc;
+
+	return 0;
+}
+
+int main( int argc, char **argv ) {
+	const char *cclass = "simple";
+	unsigned int inum = 0, options = 0;
+	int opt;
+
+	while( ( opt = getopt( argc, argv, "c:n:HLZ" ) ) != -1 )
+		switch( opt ) {
+			case 'c': cclass = optarg; break;
+			case 'n': inum = ( unsigned int ) atoi( optarg ); break;
+			case 'H': options |= SLAB_HUGE_PAGES; break;
+			case 'L': options |= SLAB_LIFO; break;
+			case 'Z': options |= SLAB_ZERO; break;
+			default:
+				fprintf( stderr,
+					"usage: %s [-c simple|lockable|zoned|striped] "
+						"[-n inum] [-H] [-L] [-Z] file...\n",
+					argv[ 0 ]
+				);
+				return 1;
+		}
+
+	for( int cyc = optind; cyc < argc; ++cyc )
+		if( _load( argv[ cyc ] ) ) {
+			fprintf( stderr, "%s: can't load trace\n", argv[ cyc ] );
+			return 1;
+		}
+
+	qsort( _G_events, _G_nevents, sizeof( pool_trace_event_t ),
+		_compare_events
+	);
+	_collect_caches();
+
+	for( size_t cyc = 0; cyc < _G_ncaches; ++cyc ) {
+		replay_cache_t *c = _G_caches + cyc;
+		if( c->sclass.blk_sz == 0 )
+			continue;
+
+		c->cache = _create( cclass,
+			options | ( c->referable ? SLAB_REFERABLE : 0 ),
+			&( c->sclass ),
+			inum
+		);
+
+		if( c->cache == NULL ) {
+			fprintf( stderr, "can't create %s cache\n", cclass );
+			return 1;
+		}
+	}
+
+	// there are no more live objects than allocations; half-empty table
+	// keeps probing short even with deleted slots
+	size_t size = 1;
+	while( size < ( _G_nevents + 1 ) * 2 )
+		size <<= 1;
+
+	_G_objects = calloc( size, sizeof( object_slot_t ) );
+	if( _G_objects == NULL ) {
+		fprintf( stderr, "can't allocate object table\n" );
+		return 1;
+	}
+
+	// table pages are touched now, so replay doesn't fault them in
+	memset( _G_objects, 0, size * sizeof( object_slot_t ) );
+	_G_mask = size - 1;
+
+	size_t base_rss = _get_rss(), peak_rss = base_rss;
+
+	unsigned long long hist[ LATENCY_BUCKETS ] = { 0 };
+	unsigned long long ops = 0;
+	uint64_t max = 0, elapsed = 0;
+
+	for( size_t cyc = 0; cyc < _G_nevents; ++cyc ) {
+		pool_trace_event_t *e = _G_events + cyc;
+		replay_cache_t *c = _find_cache( e->cache );
+		object_slot_t *s = NULL;
+
+		if( c->cache == NULL )
+			continue;
+
+		if( ( e->type != POOL_TRACE_ALLOC ) &&
+			( e->type != POOL_TRACE_REAP ) &&
+			( ( s = _lookup( e->cache, e->obj, 0 ) ) == NULL )
+		)
+			continue;
+
+		uint64_t start = _now();
+		void *ret = NULL;
+
+		switch( e->type ) {
+			case POOL_TRACE_ALLOC:
+				ret = pool_object_alloc( c->cache );
+				break;
+			case POOL_TRACE_GET:
+				pool_object_get( c->cache, s->ptr );
+				break;
+			case POOL_TRACE_PUT:
+				ret = pool_object_put( c->cache, s->ptr );
+				break;
+			case POOL_TRACE_REAP:
+				pool_reap( c->cache );
+				break;
+		}
+
+		uint64_t ns = _now() - start;
+
+		if( ( e->type == POOL_TRACE_ALLOC ) && ( ret != NULL ) ) {
+			s = _lookup( e->cache, e->obj, 1 );
+			s->cache = e->cache;
+			s->obj = e->obj;
+			s->ptr = ret;
+		} else if( ( e->type == POOL_TRACE_PUT ) && ( ret == NULL ) )
+			s->cache = UINT64_MAX;
+
+		++( hist[ ( ns == 0 ) ? 0 : ( 63 - __builtin_clzll( ns ) ) ] );
+		elapsed += ns;
+		if( ns > max )
+			max = ns;
+
+		++ops;
+
+		if( ( ops % RSS_SAMPLE_OPS ) == 0 ) {
+			size_t rss = _get_rss();
+			if( rss > peak_rss )
+				peak_rss = rss;
+		}
+	}
+
+	size_t rss = _get_rss();
+	if( rss > peak_rss )
+		peak_rss = rss;
+
+	printf( "%s: %llu ops, %.0f ops/s\n",
+		cclass,
+		ops,
+		( elapsed == 0 ) ? 0.0 : ops * 1e9 / elapsed
+	);
+	printf( "latency: p50 < %llu ns, p99 < %llu ns, p99.9 < %llu ns, "
+			"max %llu ns\n",
+		( unsigned long long ) _percentile( hist, ops, 0.5 ) * 2,
+		( unsigned long long ) _percentile( hist, ops, 0.99 ) * 2,
+		( unsigned long long ) _percentile( hist, ops, 0.999 ) * 2,
+		( unsigned long long ) max
+	);
+	printf( "peak RSS growth: %zu kB (sampled each %u ops)\n",
+		peak_rss - base_rss,
+		RSS_SAMPLE_OPS
+	);
+
+	for( size_t cyc = 0; cyc < _G_ncaches; ++cyc )
+		if( _G_caches[ cyc ].cache != NULL )
+			pool_free( _G_caches[ cyc ].cache );
+
+	free( _G_objects );
+	free( _G_caches );
+	free( _G_events );
+
+	return 0;
+}